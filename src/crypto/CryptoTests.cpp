@@ -4,13 +4,19 @@
 
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/ParallelSigVerifier.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
 #include "crypto/StrKey.h"
 #include "lib/catch.hpp"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Logging.h"
+#include "util/XDROperators.h"
 #include <autocheck/autocheck.hpp>
 #include <map>
 #include <regex>
@@ -156,6 +162,82 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("verify signature cache", "[crypto]")
+{
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    auto sk = SecretKey::random();
+    std::string msg = "hello";
+    auto sig = sk.sign(msg);
+
+    REQUIRE(PubKeyUtils::verifySig(sk.getPublicKey(), sig, msg));
+    REQUIRE(PubKeyUtils::verifySig(sk.getPublicKey(), sig, msg));
+    REQUIRE(!PubKeyUtils::verifySig(sk.getPublicKey(), sig,
+                                    std::string("helloo")));
+    REQUIRE(!PubKeyUtils::verifySig(sk.getPublicKey(), sig,
+                                    std::string("helloo")));
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == 2);
+    REQUIRE(misses == 2);
+
+    SECTION("flush resets counts")
+    {
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+        REQUIRE(hits == 0);
+        REQUIRE(misses == 0);
+    }
+
+    SECTION("resizing drops results")
+    {
+        PubKeyUtils::setVerifySigCacheSize(16);
+        REQUIRE(PubKeyUtils::verifySig(sk.getPublicKey(), sig, msg));
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+        REQUIRE(hits == 0);
+        REQUIRE(misses == 1);
+        PubKeyUtils::setVerifySigCacheSize(Config().VERIFY_SIG_CACHE_SIZE);
+    }
+}
+
+TEST_CASE("parallel signature verify tests", "[crypto]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+
+    ParallelSigVerifier verifier;
+    std::vector<SecretKey> keys;
+    for (int i = 0; i < 20; i++)
+    {
+        keys.emplace_back(SecretKey::random());
+        auto msg = randomBytes(64);
+        REQUIRE(verifier.add(keys.back().getPublicKey(),
+                             keys.back().sign(msg), msg) == size_t(i));
+    }
+    REQUIRE(verifier.size() == 20);
+
+    SECTION("all valid")
+    {
+        REQUIRE(verifier.verify(app->getWorkerIOService(), 4));
+        for (size_t i = 0; i < verifier.size(); i++)
+        {
+            REQUIRE(verifier.isValid(i));
+        }
+    }
+
+    SECTION("one invalid")
+    {
+        std::string msg = "hello";
+        auto sig = keys[0].sign(msg);
+        auto bad = verifier.add(keys[1].getPublicKey(), sig, msg);
+        REQUIRE(!verifier.verify(app->getWorkerIOService(), 4));
+        for (size_t i = 0; i < verifier.size(); i++)
+        {
+            REQUIRE(verifier.isValid(i) == (i != bad));
+        }
+    }
+}
+
 struct SignVerifyTestcase
 {
     SecretKey key;
@@ -325,3 +407,25 @@ TEST_CASE("StrKey tests", "[crypto]")
     LOG(INFO) << "CRC16 error-detection rate " << detectionRate;
     REQUIRE(detectionRate > 98.0);
 }
+
+TEST_CASE("DB key tests", "[crypto]")
+{
+    auto pk = SecretKey::random().getPublicKey();
+    auto dbKey = KeyUtils::toDbKey(pk);
+    REQUIRE(dbKey.size() == 44);
+    REQUIRE(KeyUtils::fromDbKey<PublicKey>(dbKey) == pk);
+    REQUIRE(KeyUtils::strKeyToDbKey(KeyUtils::toStrKey(pk)) == dbKey);
+
+    SignerKey sk;
+    sk.type(SIGNER_KEY_TYPE_HASH_X);
+    sk.hashX() = sha256("db key");
+    auto dbSignerKey = KeyUtils::toDbKey(sk);
+    REQUIRE(KeyUtils::fromDbKey<SignerKey>(dbSignerKey) == sk);
+    REQUIRE(KeyUtils::strKeyToDbKey(KeyUtils::toStrKey(sk)) == dbSignerKey);
+
+    // a hash(x) key is not a valid public key
+    REQUIRE_THROWS_AS(KeyUtils::fromDbKey<PublicKey>(dbSignerKey),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(KeyUtils::fromDbKey<PublicKey>(dbKey.substr(1)),
+                      std::invalid_argument);
+}
@@ -5,10 +5,19 @@
 #include "KeyUtils.h"
 
 #include "crypto/StrKey.h"
+#include "util/Decoder.h"
+
+#include <array>
 
 namespace stellar
 {
 
+namespace
+{
+// version byte followed by the 32 byte key
+size_t const DB_KEY_RAW_SIZE = 1 + 32;
+}
+
 size_t
 KeyUtils::getKeyVersionSize(strKey::StrKeyVersionByte keyVersion)
 {
@@ -25,4 +34,52 @@ KeyUtils::getKeyVersionSize(strKey::StrKeyVersionByte keyVersion)
                                     std::to_string(keyVersion));
     }
 }
+
+std::string
+KeyUtils::encodeDbKey(strKey::StrKeyVersionByte keyVersion,
+                      uint256 const& value)
+{
+    std::array<uint8_t, DB_KEY_RAW_SIZE> raw;
+    raw[0] = static_cast<uint8_t>(keyVersion);
+    std::copy(value.begin(), value.end(), raw.begin() + 1);
+    return decoder::encode_b64(raw);
+}
+
+bool
+KeyUtils::decodeDbKey(std::string const& s, uint8_t& outVersion,
+                      uint256& outValue)
+{
+    if (s.size() != decoder::encoded_size64(DB_KEY_RAW_SIZE))
+    {
+        return false;
+    }
+    std::vector<uint8_t> raw;
+    decoder::decode_b64(s, raw);
+    if (raw.size() != DB_KEY_RAW_SIZE)
+    {
+        return false;
+    }
+    outVersion = raw[0];
+    std::copy(raw.begin() + 1, raw.end(), outValue.begin());
+    return true;
+}
+
+std::string
+KeyUtils::strKeyToDbKey(std::string const& s)
+{
+    uint8_t verByte;
+    std::vector<uint8_t> k;
+    if (!strKey::fromStrKey(s, verByte, k))
+    {
+        throw std::invalid_argument("bad strkey: " + s);
+    }
+    auto ver = static_cast<strKey::StrKeyVersionByte>(verByte);
+    uint256 value;
+    if (k.size() != getKeyVersionSize(ver) || k.size() != value.size())
+    {
+        throw std::invalid_argument("bad strkey: " + s);
+    }
+    std::copy(k.begin(), k.end(), value.begin());
+    return encodeDbKey(ver, value);
+}
 }
@@ -96,6 +96,47 @@ fromStrKey(std::string const& s)
     return key;
 }
 
+// keys stored in the ledger tables use a compact form: the version byte
+// followed by the raw key, base64 encoded (no checksum)
+std::string encodeDbKey(strKey::StrKeyVersionByte keyVersion,
+                        uint256 const& value);
+bool decodeDbKey(std::string const& s, uint8_t& outVersion, uint256& outValue);
+
+// converts a StrKey (as stored by schema versions up to 7) to its compact form
+std::string strKeyToDbKey(std::string const& s);
+
+template <typename T>
+std::string
+toDbKey(T const& key)
+{
+    return encodeDbKey(KeyFunctions<T>::toKeyVersion(key.type()),
+                       KeyFunctions<T>::getKeyValue(key));
+}
+
+template <typename T>
+T
+fromDbKey(std::string const& s)
+{
+    T key;
+    uint8_t verByte;
+    uint256 k;
+    if (!decodeDbKey(s, verByte, k))
+    {
+        throw std::invalid_argument("bad " + KeyFunctions<T>::getKeyTypeName());
+    }
+
+    strKey::StrKeyVersionByte ver =
+        static_cast<strKey::StrKeyVersionByte>(verByte);
+    if (!KeyFunctions<T>::getKeyVersionIsSupported(ver))
+    {
+        throw std::invalid_argument("bad " + KeyFunctions<T>::getKeyTypeName());
+    }
+
+    key.type(KeyFunctions<T>::toKeyType(ver));
+    KeyFunctions<T>::getKeyValue(key) = k;
+    return key;
+}
+
 template <typename T, typename F>
 bool
 canConvert(F const& fromKey)
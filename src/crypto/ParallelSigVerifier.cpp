@@ -0,0 +1,44 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/ParallelSigVerifier.h"
+#include "crypto/SecretKey.h"
+#include "util/Parallel.h"
+
+#include <algorithm>
+
+namespace stellar
+{
+
+size_t
+ParallelSigVerifier::add(PublicKey const& key, Signature const& signature,
+                         ByteSlice const& message)
+{
+    mItems.emplace_back(Item{key, signature, std::vector<uint8_t>(
+                                                 message.begin(),
+                                                 message.end())});
+    return mItems.size() - 1;
+}
+
+bool
+ParallelSigVerifier::verify(asio::io_service& workers, size_t numThreads)
+{
+    mResults.assign(mItems.size(), 0);
+    parallelFor(workers, numThreads, mItems.size(), [this](size_t i) {
+        auto const& item = mItems[i];
+        mResults[i] =
+            PubKeyUtils::verifySig(item.mKey, item.mSignature, item.mMessage)
+                ? 1
+                : 0;
+    });
+    return std::all_of(mResults.begin(), mResults.end(),
+                       [](char r) { return r != 0; });
+}
+
+bool
+ParallelSigVerifier::isValid(size_t index) const
+{
+    return mResults.at(index) != 0;
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "crypto/ByteSlice.h"
+#include "xdr/Stellar-types.h"
+
+#include <vector>
+
+namespace stellar
+{
+
+// Verifies a set of ed25519 signatures on the worker threads, for callers
+// that have many signatures to check together (transaction sets, bursts of
+// SCP envelopes).
+//
+// This is not ed25519 batch verification: each signature is checked on its
+// own (through PubKeyUtils::verifySig, which also fills the verification
+// cache), the work is only spread over threads.
+class ParallelSigVerifier
+{
+    struct Item
+    {
+        PublicKey mKey;
+        Signature mSignature;
+        std::vector<uint8_t> mMessage;
+    };
+
+    std::vector<Item> mItems;
+    std::vector<char> mResults;
+
+  public:
+    // adds a signature to verify, returns its index
+    size_t add(PublicKey const& key, Signature const& signature,
+               ByteSlice const& message);
+
+    size_t
+    size() const
+    {
+        return mItems.size();
+    }
+
+    // verifies all the signatures added so far, using up to `numThreads`
+    // threads from `workers` in addition to the calling thread; returns true
+    // if all of them are valid
+    bool verify(asio::io_service& workers, size_t numThreads);
+
+    // result for the signature at `index`, only valid after verify
+    bool isValid(size_t index) const;
+};
+}
@@ -32,6 +32,13 @@ HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& bin);
 bool hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                       ByteSlice const& bin);
 
+// HMAC-SHA256 of the concatenation of `prefix` and `bin`, without copying
+// them into a single buffer.
+HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& prefix,
+                         ByteSlice const& bin);
+bool hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
+                      ByteSlice const& prefix, ByteSlice const& bin);
+
 // Unsalted HKDF-extract(bytes) == HMAC(<zero>,bytes)
 HmacSha256Key hkdfExtract(ByteSlice const& bin);
 
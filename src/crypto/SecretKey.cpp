@@ -5,12 +5,13 @@
 #include "crypto/SecretKey.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
-#include "crypto/SHA.h"
 #include "crypto/StrKey.h"
 #include "main/Config.h"
 #include "transactions/SignatureUtils.h"
 #include "util/HashOfHash.h"
 #include "util/lrucache.hpp"
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <mutex>
 #include <sodium.h>
@@ -26,11 +27,40 @@ namespace stellar
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
 
-static std::mutex gVerifySigCacheMutex;
-static cache::lru_cache<Hash, bool> gVerifySigCache(0xffff);
-static std::unique_ptr<SHA256> gHasher = SHA256::create();
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
+// verifySig may be called from worker threads (see
+// TransactionFrame::preVerifySignatures), so the cache is split in shards,
+// each with its own mutex: a lookup only locks the shard its key falls in.
+//
+// Entries are keyed by a keyed BLAKE2b hash of the public key, signature and
+// message. The hash key is drawn at random when the process starts, so
+// collisions cannot be searched for offline.
+
+static size_t const kVerifySigCacheShards = 16;
+static size_t const kDefaultVerifySigCacheSize = 0xffff;
+
+struct VerifySigCacheShard
+{
+    std::mutex mMutex;
+    size_t mSize;
+    std::unique_ptr<cache::lru_cache<Hash, bool>> mCache;
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+
+    VerifySigCacheShard()
+        : mSize(shardSize(kDefaultVerifySigCacheSize))
+        , mCache(std::make_unique<cache::lru_cache<Hash, bool>>(mSize))
+    {
+    }
+
+    static size_t
+    shardSize(size_t totalSize)
+    {
+        return std::max<size_t>(
+            1, (totalSize + kVerifySigCacheShards - 1) / kVerifySigCacheShards);
+    }
+};
+
+static std::array<VerifySigCacheShard, kVerifySigCacheShards> gVerifySigCache;
 
 static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
@@ -38,11 +68,29 @@ verifySigCacheKey(PublicKey const& key, Signature const& signature,
 {
     assert(key.type() == PUBLIC_KEY_TYPE_ED25519);
 
-    gHasher->reset();
-    gHasher->add(key.ed25519());
-    gHasher->add(signature);
-    gHasher->add(bin);
-    return gHasher->finish();
+    static uint256 const hashKey = []() {
+        uint256 k;
+        randombytes_buf(k.data(), k.size());
+        return k;
+    }();
+
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, hashKey.data(), hashKey.size(),
+                            sizeof(Hash));
+    crypto_generichash_update(&state, key.ed25519().data(),
+                              key.ed25519().size());
+    crypto_generichash_update(&state, signature.data(), signature.size());
+    crypto_generichash_update(&state, bin.data(), bin.size());
+    Hash res;
+    crypto_generichash_final(&state, res.data(), res.size());
+    return res;
+}
+
+static VerifySigCacheShard&
+verifySigCacheShard(Hash const& cacheKey)
+{
+    // std::hash<uint256> uses the first bytes, pick the shard from the last
+    return gVerifySigCache[cacheKey.back() % kVerifySigCacheShards];
 }
 
 SecretKey::SecretKey() : mKeyType(PUBLIC_KEY_TYPE_ED25519)
@@ -187,18 +235,42 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.clear();
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache->clear();
+    }
+}
+
+void
+PubKeyUtils::setVerifySigCacheSize(size_t size)
+{
+    auto shardSize = VerifySigCacheShard::shardSize(size);
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mSize != shardSize)
+        {
+            shard.mSize = shardSize;
+            shard.mCache =
+                std::make_unique<cache::lru_cache<Hash, bool>>(shardSize);
+        }
+    }
 }
 
 void
 PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
+    hits = 0;
+    misses = 0;
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        hits += shard.mHits;
+        misses += shard.mMisses;
+        shard.mHits = 0;
+        shard.mMisses = 0;
+    }
 }
 
 std::string
@@ -279,22 +351,23 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     }
 
     auto cacheKey = verifySigCacheKey(key, signature, bin);
+    auto& shard = verifySigCacheShard(cacheKey);
 
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->exists(cacheKey))
         {
-            ++gVerifyCacheHit;
-            return gVerifySigCache.get(cacheKey);
+            ++shard.mHits;
+            return shard.mCache->get(cacheKey);
         }
     }
 
-    ++gVerifyCacheMiss;
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.put(cacheKey, ok);
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    ++shard.mMisses;
+    shard.mCache->put(cacheKey, ok);
     return ok;
 }
 
@@ -102,6 +102,9 @@ bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
 void clearVerifySigCache();
+// Sets the number of results kept by verifySig (process-wide), drops the
+// ones currently cached if the size changes.
+void setVerifySigCacheSize(size_t size);
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
 
 PublicKey random();
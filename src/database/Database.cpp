@@ -4,6 +4,7 @@
 
 #include "database/Database.h"
 #include "crypto/Hex.h"
+#include "crypto/KeyUtils.h"
 #include "database/DatabaseConnectionString.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -20,6 +21,7 @@
 #include "ledger/DataFrame.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
 #include "ledger/TrustFrame.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
@@ -53,7 +55,48 @@ using namespace std;
 
 bool Database::gDriversRegistered = false;
 
-static unsigned long const SCHEMA_VERSION = 6;
+static unsigned long const SCHEMA_VERSION = 9;
+
+// rewrites the StrKey values of a column in the compact form used by the
+// ledger tables since schema version 8; the conversion is done in code, once
+// per distinct key, and applied by a single statement joining a mapping table
+// on its primary key, as most of the columns are not indexed
+static void
+convertStrKeyColumn(soci::session& sess, std::string const& table,
+                    std::string const& column)
+{
+    sess << "DELETE FROM strkeymap";
+    {
+        std::vector<std::string> keys;
+        std::string key;
+        soci::statement st =
+            (sess.prepare << "SELECT DISTINCT " << column << " FROM " << table
+                          << " WHERE " << column << " IS NOT NULL",
+             into(key));
+        st.execute(true);
+        while (st.got_data())
+        {
+            keys.emplace_back(key);
+            st.fetch();
+        }
+
+        std::string oldKey, newKey;
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO strkeymap (oldkey, newkey) "
+                             "VALUES (:old, :new)",
+             use(oldKey), use(newKey));
+        for (auto const& k : keys)
+        {
+            oldKey = k;
+            newKey = KeyUtils::strKeyToDbKey(k);
+            ins.execute(true);
+        }
+    }
+
+    sess << "UPDATE " << table << " SET " << column
+         << " = (SELECT newkey FROM strkeymap WHERE oldkey = " << table << "."
+         << column << ") WHERE " << column << " IS NOT NULL";
+}
 
 static void
 setSerializable(soci::session& sess)
@@ -82,6 +125,7 @@ Database::Database(Application& app)
     , mStatementsSize(
           app.getMetrics().NewCounter({"database", "memory", "statements"}))
     , mEntryCache(4096)
+    , mOrderBook(std::make_unique<OrderBook>())
     , mExcludedQueryTime(0)
     , mExcludedTotalTime(0)
     , mLastIdleQueryTime(0)
@@ -106,6 +150,10 @@ Database::Database(Application& app)
     }
 }
 
+Database::~Database()
+{
+}
+
 void
 Database::applySchemaUpgrade(unsigned long vers)
 {
@@ -143,6 +191,35 @@ Database::applySchemaUpgrade(unsigned long vers)
     case 6:
         mSession << "ALTER TABLE peers ADD flags INT NOT NULL DEFAULT 0";
         break;
+    case 7:
+        mSession << "ALTER TABLE accounts ADD hassigners INT NOT NULL "
+                    "DEFAULT 0";
+        mSession << "UPDATE accounts SET hassigners = 1 WHERE accountid IN "
+                    "(SELECT DISTINCT accountid FROM signers)";
+        break;
+    case 8:
+    {
+        soci::transaction tx(mSession);
+        mSession << "CREATE TEMPORARY TABLE strkeymap ("
+                    "oldkey VARCHAR(56) PRIMARY KEY, "
+                    "newkey VARCHAR(56) NOT NULL)";
+        convertStrKeyColumn(mSession, "accounts", "accountid");
+        convertStrKeyColumn(mSession, "accounts", "inflationdest");
+        convertStrKeyColumn(mSession, "signers", "accountid");
+        convertStrKeyColumn(mSession, "signers", "publickey");
+        convertStrKeyColumn(mSession, "trustlines", "accountid");
+        convertStrKeyColumn(mSession, "trustlines", "issuer");
+        convertStrKeyColumn(mSession, "offers", "sellerid");
+        convertStrKeyColumn(mSession, "offers", "sellingissuer");
+        convertStrKeyColumn(mSession, "offers", "buyingissuer");
+        convertStrKeyColumn(mSession, "accountdata", "accountid");
+        mSession << "DROP TABLE strkeymap";
+        tx.commit();
+    }
+    break;
+    case 9:
+        AccountFrame::createInflationVotes(*this);
+        break;
     default:
         throw std::runtime_error("Unknown DB schema version");
         break;
@@ -349,6 +426,12 @@ Database::getEntryCache()
     return mEntryCache;
 }
 
+OrderBook&
+Database::getOrderBook()
+{
+    return *mOrderBook;
+}
+
 class SQLLogContext : NonCopyable
 {
     std::string mName;
@@ -23,6 +23,7 @@ class Counter;
 namespace stellar
 {
 class Application;
+class OrderBook;
 class SQLLogContext;
 
 /**
@@ -94,6 +95,7 @@ class Database : NonMovableOrCopyable
 
     cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         mEntryCache;
+    std::unique_ptr<OrderBook> mOrderBook;
 
     // Helpers for maintaining the total query time and calculating
     // idle percentage.
@@ -111,6 +113,7 @@ class Database : NonMovableOrCopyable
     // Instantiate object and connect to app.getConfig().DATABASE;
     // if there is a connection error, this will throw.
     Database(Application& app);
+    ~Database();
 
     // Return a crude meter of total queries to the db, for use in
     // overlay/LoadManager.
@@ -195,6 +198,10 @@ class Database : NonMovableOrCopyable
     typedef cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         EntryCache;
     EntryCache& getEntryCache();
+
+    // Access the in-memory order books used when crossing offers. Like the
+    // entry cache, they are maintained by the ledger entry frames.
+    OrderBook& getOrderBook();
 };
 
 class DBTimeExcluder : NonCopyable
@@ -108,9 +108,25 @@ class Herder
     virtual bool recvTxSet(Hash const& hash, TxSetFrame const& txset) = 0;
     // We are learning about a new transaction.
     virtual TransactionSubmitStatus recvTransaction(TransactionFramePtr tx) = 0;
+    // Same as recvTransaction, for transactions coming from the network: the
+    // checks that do not need the ledger are done on the worker threads,
+    // `done` is called on the main thread with the result.
+    virtual void
+    recvTransaction(TransactionFramePtr tx,
+                    std::function<void(TransactionSubmitStatus)> done) = 0;
+    // Same as above for transactions received together, which are checked by
+    // a single worker task; `done` is called once per transaction, in order.
+    virtual void recvTransactions(
+        std::vector<TransactionFramePtr> const& txs,
+        std::function<void(TransactionFramePtr const&, TransactionSubmitStatus)>
+            done) = 0;
     virtual void peerDoesntHave(stellar::MessageType type,
                                 uint256 const& itemID, PeerPtr peer) = 0;
     virtual TxSetFramePtr getTxSet(Hash const& hash) = 0;
+    // returns the pending transaction with the given full hash, if any
+    virtual TransactionFramePtr getTx(Hash const& fullHash) = 0;
+    // returns all the pending transactions, in no particular order
+    virtual std::vector<TransactionFramePtr> getPendingTxs() = 0;
     virtual SCPQuorumSetPtr getQSet(Hash const& qSetHash) = 0;
 
     // We are learning about a new envelope.
@@ -70,6 +70,10 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
 
 HerderImpl::HerderImpl(Application& app)
     : mPendingTransactions(4)
+    , mTxAdmissionQueue(app,
+                        [this](TransactionFramePtr tx) {
+                            return recvTransaction(tx);
+                        })
     , mPendingEnvelopes(app, *this)
     , mHerderSCPDriver(app, *this, mUpgrades, mPendingEnvelopes)
     , mLastSlotSaved(0)
@@ -136,34 +140,6 @@ HerderImpl::updateSCPCounters()
         getSCP().getCumulativeStatemtCount());
 }
 
-static uint64_t
-countTxs(HerderImpl::AccountTxMap const& acc)
-{
-    uint64_t sz = 0;
-    for (auto const& a : acc)
-    {
-        sz += a.second->mTransactions.size();
-    }
-    return sz;
-}
-
-static std::shared_ptr<HerderImpl::TxMap>
-findOrAdd(HerderImpl::AccountTxMap& acc, AccountID const& aid)
-{
-    std::shared_ptr<HerderImpl::TxMap> txmap = nullptr;
-    auto i = acc.find(aid);
-    if (i == acc.end())
-    {
-        txmap = std::make_shared<HerderImpl::TxMap>();
-        acc.insert(std::make_pair(aid, txmap));
-    }
-    else
-    {
-        txmap = i->second;
-    }
-    return txmap;
-}
-
 void
 HerderImpl::valueExternalized(uint64 slotIndex, StellarValue const& value)
 {
@@ -281,31 +257,6 @@ HerderImpl::emitEnvelope(SCPEnvelope const& envelope)
     startRebroadcastTimer();
 }
 
-void
-HerderImpl::TxMap::addTx(TransactionFramePtr tx)
-{
-    auto const& h = tx->getFullHash();
-    if (mTransactions.find(h) != mTransactions.end())
-    {
-        return;
-    }
-    mTransactions.insert(std::make_pair(h, tx));
-    mMaxSeq = std::max(tx->getSeqNum(), mMaxSeq);
-    mTotalFees += tx->getFee();
-}
-
-void
-HerderImpl::TxMap::recalculate()
-{
-    mMaxSeq = 0;
-    mTotalFees = 0;
-    for (auto const& pair : mTransactions)
-    {
-        mMaxSeq = std::max(pair.second->getSeqNum(), mMaxSeq);
-        mTotalFees += pair.second->getFee();
-    }
-}
-
 Herder::TransactionSubmitStatus
 HerderImpl::recvTransaction(TransactionFramePtr tx)
 {
@@ -317,25 +268,14 @@ HerderImpl::recvTransaction(TransactionFramePtr tx)
 
     // determine if we have seen this tx before and if not if it has the right
     // seq num
-    int64_t totFee = tx->getFee();
-    SequenceNumber highSeq = 0;
-
-    for (auto& map : mPendingTransactions)
+    if (mPendingTransactions.contains(txID))
     {
-        auto i = map.find(acc);
-        if (i != map.end())
-        {
-            auto& txmap = i->second;
-            auto j = txmap->mTransactions.find(txID);
-            if (j != txmap->mTransactions.end())
-            {
-                return TX_STATUS_DUPLICATE;
-            }
-            totFee += txmap->mTotalFees;
-            highSeq = std::max(highSeq, txmap->mMaxSeq);
-        }
+        return TX_STATUS_DUPLICATE;
     }
 
+    int64_t totFee = tx->getFee() + mPendingTransactions.getTotalFees(acc);
+    SequenceNumber highSeq = mPendingTransactions.getMaxSeq(acc);
+
     if (!tx->checkValid(mApp, highSeq))
     {
         return TX_STATUS_ERROR;
@@ -351,12 +291,27 @@ HerderImpl::recvTransaction(TransactionFramePtr tx)
         CLOG(TRACE, "Herder") << "recv transaction " << hexAbbrev(txID)
                               << " for " << KeyUtils::toShortString(acc);
 
-    auto txmap = findOrAdd(mPendingTransactions[0], acc);
-    txmap->addTx(tx);
+    mPendingTransactions.add(tx);
 
     return TX_STATUS_PENDING;
 }
 
+void
+HerderImpl::recvTransaction(TransactionFramePtr tx,
+                            std::function<void(TransactionSubmitStatus)> done)
+{
+    mTxAdmissionQueue.add(tx, std::move(done));
+}
+
+void
+HerderImpl::recvTransactions(
+    std::vector<TransactionFramePtr> const& txs,
+    std::function<void(TransactionFramePtr const&, TransactionSubmitStatus)>
+        done)
+{
+    mTxAdmissionQueue.add(txs, std::move(done));
+}
+
 Herder::EnvelopeStatus
 HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
 {
@@ -506,6 +461,10 @@ HerderImpl::processSCPQueue()
 void
 HerderImpl::processSCPQueueUpToIndex(uint64 slotIndex)
 {
+    // check the signatures of the whole burst at once
+    mHerderSCPDriver.verifyEnvelopes(
+        mPendingEnvelopes.readyEnvelopes(slotIndex));
+
     while (true)
     {
         SCPEnvelope env;
@@ -586,44 +545,7 @@ HerderImpl::ledgerClosed()
 void
 HerderImpl::removeReceivedTxs(std::vector<TransactionFramePtr> const& dropTxs)
 {
-    for (auto& m : mPendingTransactions)
-    {
-        if (m.empty())
-        {
-            continue;
-        }
-
-        std::set<std::shared_ptr<TxMap>> toRecalculate;
-
-        for (auto const& tx : dropTxs)
-        {
-            auto const& acc = tx->getSourceID();
-            auto const& txID = tx->getFullHash();
-            auto i = m.find(acc);
-            if (i != m.end())
-            {
-                auto& txs = i->second->mTransactions;
-                auto j = txs.find(txID);
-                if (j != txs.end())
-                {
-                    txs.erase(j);
-                    if (txs.empty())
-                    {
-                        m.erase(i);
-                    }
-                    else
-                    {
-                        toRecalculate.insert(i->second);
-                    }
-                }
-            }
-        }
-
-        for (auto txm : toRecalculate)
-        {
-            txm->recalculate();
-        }
-    }
+    mPendingTransactions.remove(dropTxs);
 }
 
 bool
@@ -652,6 +574,18 @@ HerderImpl::getTxSet(Hash const& hash)
     return mPendingEnvelopes.getTxSet(hash);
 }
 
+TransactionFramePtr
+HerderImpl::getTx(Hash const& fullHash)
+{
+    return mPendingTransactions.getTx(fullHash);
+}
+
+std::vector<TransactionFramePtr>
+HerderImpl::getPendingTxs()
+{
+    return mPendingTransactions.getTransactions();
+}
+
 SCPQuorumSetPtr
 HerderImpl::getQSet(Hash const& qSetHash)
 {
@@ -681,17 +615,7 @@ HerderImpl::getCurrentLedgerSeq() const
 SequenceNumber
 HerderImpl::getMaxSeqInPendingTxs(AccountID const& acc)
 {
-    SequenceNumber highSeq = 0;
-    for (auto const& m : mPendingTransactions)
-    {
-        auto i = m.find(acc);
-        if (i == m.end())
-        {
-            continue;
-        }
-        highSeq = std::max(i->second->mMaxSeq, highSeq);
-    }
-    return highSeq;
+    return mPendingTransactions.getMaxSeq(acc);
 }
 
 // called to take a position during the next round
@@ -707,26 +631,49 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger)
     }
     updateSCPCounters();
 
-    // our first choice for this round's set is all the tx we have collected
-    // during last ledger close
+    // our first choice for this round's set is the tx we have collected
+    // during last ledger close, taking the accounts paying the most first
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
     auto proposedSet = std::make_shared<TxSetFrame>(lcl.hash);
+    auto maxTxSetSize = mLedgerManager.getMaxTxSetSize();
 
-    for (auto const& m : mPendingTransactions)
+    // accounts are independent from each other when validating: if some
+    // transactions turn out to be invalid, more accounts get looked at
+    std::vector<TransactionFramePtr> removed;
+    size_t accountsTaken = 0;
+    while (proposedSet->size() < maxTxSetSize)
     {
-        for (auto const& pair : m)
+        TxSetFrame batch(lcl.hash);
+        size_t accountsSeen = 0;
+        mPendingTransactions.forEachAccountByFee(
+            [&](std::vector<TransactionFramePtr> const& txs) {
+                if (accountsSeen++ < accountsTaken)
+                {
+                    return true;
+                }
+                accountsTaken++;
+                for (auto const& tx : txs)
+                {
+                    batch.add(tx);
+                }
+                return proposedSet->size() + batch.size() < maxTxSetSize;
+            });
+        if (batch.size() == 0)
         {
-            for (auto const& tx : pair.second->mTransactions)
-            {
-                proposedSet->add(tx.second);
-            }
+            break;
         }
-    }
 
-    std::vector<TransactionFramePtr> removed;
-    proposedSet->trimInvalid(mApp, removed);
+        batch.trimInvalid(mApp, removed);
+        for (auto const& tx : batch.mTransactions)
+        {
+            proposedSet->add(tx);
+        }
+    }
+    // only done once all batches are built, as it changes the order of the
+    // accounts
     removeReceivedTxs(removed);
 
+    proposedSet->sortForHash();
     proposedSet->surgePricingFilter(mLedgerManager);
 
     if (!proposedSet->checkValid(mApp))
@@ -1051,26 +998,17 @@ HerderImpl::updatePendingTransactions(
     // remove all these tx from mPendingTransactions
     removeReceivedTxs(applied);
 
-    // drop the highest level
-    mPendingTransactions.erase(--mPendingTransactions.end());
-
-    // shift entries up
-    mPendingTransactions.emplace_front();
+    // drop the oldest transactions
+    mPendingTransactions.shift();
 
     // rebroadcast entries, sorted in apply-order to maximize chances of
     // propagation
     {
         Hash h;
         TxSetFrame toBroadcast(h);
-        for (auto const& l : mPendingTransactions)
+        for (auto const& tx : mPendingTransactions.getTransactions())
         {
-            for (auto const& pair : l)
-            {
-                for (auto const& tx : pair.second->mTransactions)
-                {
-                    toBroadcast.add(tx.second);
-                }
-            }
+            toBroadcast.add(tx);
         }
         for (auto tx : toBroadcast.sortForApply())
         {
@@ -1079,10 +1017,14 @@ HerderImpl::updatePendingTransactions(
         }
     }
 
-    mSCPMetrics.mHerderPendingTxs0.set_count(countTxs(mPendingTransactions[0]));
-    mSCPMetrics.mHerderPendingTxs1.set_count(countTxs(mPendingTransactions[1]));
-    mSCPMetrics.mHerderPendingTxs2.set_count(countTxs(mPendingTransactions[2]));
-    mSCPMetrics.mHerderPendingTxs3.set_count(countTxs(mPendingTransactions[3]));
+    mSCPMetrics.mHerderPendingTxs0.set_count(
+        mPendingTransactions.sizeByAge(0));
+    mSCPMetrics.mHerderPendingTxs1.set_count(
+        mPendingTransactions.sizeByAge(1));
+    mSCPMetrics.mHerderPendingTxs2.set_count(
+        mPendingTransactions.sizeByAge(2));
+    mSCPMetrics.mHerderPendingTxs3.set_count(
+        mPendingTransactions.sizeByAge(3));
 }
 
 void
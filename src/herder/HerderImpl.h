@@ -7,6 +7,8 @@
 #include "PendingEnvelopes.h"
 #include "herder/Herder.h"
 #include "herder/HerderSCPDriver.h"
+#include "herder/TransactionQueue.h"
+#include "herder/TxAdmissionQueue.h"
 #include "herder/Upgrades.h"
 #include "util/Timer.h"
 #include "util/XDROperators.h"
@@ -58,6 +60,13 @@ class HerderImpl : public Herder
     void emitEnvelope(SCPEnvelope const& envelope);
 
     TransactionSubmitStatus recvTransaction(TransactionFramePtr tx) override;
+    void
+    recvTransaction(TransactionFramePtr tx,
+                    std::function<void(TransactionSubmitStatus)> done) override;
+    void recvTransactions(
+        std::vector<TransactionFramePtr> const& txs,
+        std::function<void(TransactionFramePtr const&, TransactionSubmitStatus)>
+            done) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
@@ -71,6 +80,8 @@ class HerderImpl : public Herder
     void peerDoesntHave(MessageType type, uint256 const& itemID,
                         PeerPtr peer) override;
     TxSetFramePtr getTxSet(Hash const& hash) override;
+    TransactionFramePtr getTx(Hash const& fullHash) override;
+    std::vector<TransactionFramePtr> getPendingTxs() override;
     SCPQuorumSetPtr getQSet(Hash const& qSetHash) override;
 
     void processSCPQueue();
@@ -90,16 +101,6 @@ class HerderImpl : public Herder
     Json::Value getJsonQuorumInfo(NodeID const& id, bool summary,
                                   uint64 index) override;
 
-    struct TxMap
-    {
-        SequenceNumber mMaxSeq{0};
-        int64_t mTotalFees{0};
-        std::unordered_map<Hash, TransactionFramePtr> mTransactions;
-        void addTx(TransactionFramePtr);
-        void recalculate();
-    };
-    typedef std::unordered_map<AccountID, std::shared_ptr<TxMap>> AccountTxMap;
-
   private:
     void ledgerClosed();
     void removeReceivedTxs(std::vector<TransactionFramePtr> const& txs);
@@ -112,11 +113,12 @@ class HerderImpl : public Herder
 
     void processSCPQueueUpToIndex(uint64 slotIndex);
 
-    // 0- tx we got during ledger close
-    // 1- one ledger ago. rebroadcast
-    // 2- two ledgers ago. rebroadcast
-    // ...
-    std::deque<AccountTxMap> mPendingTransactions;
+    // transactions received and not applied yet, kept for up to 4 ledgers
+    // (rebroadcast at every ledger close)
+    TransactionQueue mPendingTransactions;
+
+    // transactions received from the network, waiting to be validated
+    TxAdmissionQueue mTxAdmissionQueue;
 
     void
     updatePendingTransactions(std::vector<TransactionFramePtr> const& applied);
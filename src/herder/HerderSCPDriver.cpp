@@ -4,6 +4,7 @@
 
 #include "herder/HerderSCPDriver.h"
 #include "crypto/Hex.h"
+#include "crypto/ParallelSigVerifier.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "herder/HerderImpl.h"
@@ -16,6 +17,7 @@
 #include "xdr/Stellar-SCP.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include <medida/metrics_registry.h>
+#include <thread>
 #include <util/format.h>
 #include <xdrpp/marshal.h>
 
@@ -32,6 +34,10 @@ HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
     , mValueValid(app.getMetrics().NewMeter({"scp", "value", "valid"}, "value"))
     , mValueInvalid(
           app.getMetrics().NewMeter({"scp", "value", "invalid"}, "value"))
+    , mTxSetChecked(
+          app.getMetrics().NewMeter({"scp", "txset", "checked"}, "txset"))
+    , mTxSetCached(
+          app.getMetrics().NewMeter({"scp", "txset", "cached"}, "txset"))
     , mValueExternalize(
           app.getMetrics().NewMeter({"scp", "value", "externalize"}, "value"))
     , mQuorumHeard(
@@ -158,6 +164,26 @@ HerderSCPDriver::verifyEnvelope(SCPEnvelope const& envelope)
     return b;
 }
 
+void
+HerderSCPDriver::verifyEnvelopes(
+    std::vector<SCPEnvelope const*> const& envelopes)
+{
+    if (envelopes.size() < 2)
+    {
+        return;
+    }
+
+    ParallelSigVerifier verifier;
+    for (auto e : envelopes)
+    {
+        verifier.add(e->statement.nodeID, e->signature,
+                     xdr::xdr_to_opaque(mApp.getNetworkID(), ENVELOPE_TYPE_SCP,
+                                        e->statement));
+    }
+    verifier.verify(mApp.getWorkerIOService(),
+                    std::thread::hardware_concurrency());
+}
+
 void
 HerderSCPDriver::emitEnvelope(SCPEnvelope const& envelope)
 {
@@ -179,9 +205,32 @@ HerderSCPDriver::isSlotCompatibleWithCurrentState(uint64_t slotIndex) const
     return res;
 }
 
+bool
+HerderSCPDriver::checkTxSetValid(Hash const& txSetHash, TxSetFrame& txSet)
+{
+    // the result only depends on the tx set and the ledger it applies to
+    auto const& lclHash = mLedgerManager.getLastClosedLedgerHeader().hash;
+    if (mTxSetValidityLcl != lclHash)
+    {
+        mTxSetValidity.clear();
+        mTxSetValidityLcl = lclHash;
+    }
+
+    auto it = mTxSetValidity.find(txSetHash);
+    if (it != mTxSetValidity.end())
+    {
+        mSCPMetrics.mTxSetCached.Mark();
+        return it->second;
+    }
+
+    mSCPMetrics.mTxSetChecked.Mark();
+    bool res = txSet.checkValid(mApp);
+    mTxSetValidity.emplace(txSetHash, res);
+    return res;
+}
+
 SCPDriver::ValidationLevel
-HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
-                                     StellarValue const& b) const
+HerderSCPDriver::validateValueHelper(uint64_t slotIndex, StellarValue const& b)
 {
     uint64_t lastCloseTime;
 
@@ -256,7 +305,7 @@ HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
 
         res = SCPDriver::kInvalidValue;
     }
-    else if (!txSet->checkValid(mApp))
+    else if (!checkTxSetValid(txSetHash, *txSet))
     {
         if (Logging::logDebug("Herder"))
             CLOG(DEBUG, "Herder") << "HerderSCPDriver::validateValue"
@@ -7,8 +7,11 @@
 #include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
 #include "scp/SCPDriver.h"
+#include "util/HashOfHash.h"
 #include "xdr/Stellar-ledger.h"
 
+#include <unordered_map>
+
 namespace medida
 {
 class Counter;
@@ -93,6 +96,9 @@ class HerderSCPDriver : public SCPDriver
     // envelope handling
     void signEnvelope(SCPEnvelope& envelope) override;
     bool verifyEnvelope(SCPEnvelope const& envelope) override;
+    // checks the signatures of several envelopes at once, so that the
+    // following calls to verifyEnvelope hit the verification cache
+    void verifyEnvelopes(std::vector<SCPEnvelope const*> const& envelopes);
     void emitEnvelope(SCPEnvelope const& envelope) override;
 
     // value validation
@@ -154,6 +160,10 @@ class HerderSCPDriver : public SCPDriver
         medida::Meter& mValueValid;
         medida::Meter& mValueInvalid;
 
+        // tx set validations done and saved by the memo
+        medida::Meter& mTxSetChecked;
+        medida::Meter& mTxSetCached;
+
         medida::Meter& mValueExternalize;
 
         // listeners
@@ -211,8 +221,15 @@ class HerderSCPDriver : public SCPDriver
 
     void stateChanged();
 
-    SCPDriver::ValidationLevel
-    validateValueHelper(uint64_t slotIndex, StellarValue const& sv) const;
+    // results of TxSetFrame::checkValid by tx set hash, only valid as long
+    // as the last closed ledger is mTxSetValidityLcl
+    Hash mTxSetValidityLcl;
+    std::unordered_map<Hash, bool> mTxSetValidity;
+
+    bool checkTxSetValid(Hash const& txSetHash, TxSetFrame& txSet);
+
+    SCPDriver::ValidationLevel validateValueHelper(uint64_t slotIndex,
+                                                   StellarValue const& sv);
 
     // returns true if the local instance is in a state compatible with
     // this slot
@@ -20,6 +20,7 @@
 #include "main/CommandHandler.h"
 #include "overlay/OverlayManager.h"
 #include "test/TxTests.h"
+#include "util/Logging.h"
 
 #include "xdrpp/marshal.h"
 
@@ -222,6 +223,52 @@ TEST_CASE("recvTx", "[herder]")
 {
 }
 
+TEST_CASE("recvTx from network", "[herder]")
+{
+    Config cfg(getTestConfig());
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto a = root.create("A", app->getLedgerManager().getMinBalance(0) * 10);
+
+    std::vector<TransactionFramePtr> txs;
+    for (int i = 0; i < 10; i++)
+    {
+        txs.emplace_back(a.tx({payment(root, 1)}));
+    }
+    // a duplicate and a transaction with a bad sequence number
+    txs.emplace_back(txs[5]);
+    txs.emplace_back(a.tx({payment(root, 1)}, a.getLastSequenceNumber() + 2));
+
+    std::vector<Herder::TransactionSubmitStatus> results;
+    for (auto const& tx : txs)
+    {
+        app->getHerder().recvTransaction(
+            tx, [&results](Herder::TransactionSubmitStatus status) {
+                results.push_back(status);
+            });
+    }
+
+    while (results.size() < txs.size())
+    {
+        clock.crank(false);
+    }
+
+    // transactions are admitted in the order they were received
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(results[i] == Herder::TX_STATUS_PENDING);
+    }
+    REQUIRE(results[10] == Herder::TX_STATUS_DUPLICATE);
+    REQUIRE(results[11] == Herder::TX_STATUS_ERROR);
+    REQUIRE(app->getHerder().getMaxSeqInPendingTxs(a) ==
+            txs[9]->getSeqNum());
+}
+
 TEST_CASE("txset", "[herder]")
 {
     Config cfg(getTestConfig());
@@ -351,6 +398,26 @@ TEST_CASE("txset", "[herder]")
                 REQUIRE(txSet->checkValid(*app));
             }
         }
+        SECTION("several accounts")
+        {
+            // accounts are validated independently of each other
+            auto b1 = root.create("B1", paymentAmount * 10);
+            auto b2 = root.create("B2", paymentAmount * 10);
+            auto valid = b1.tx({payment(root, 1)});
+            auto gap = b2.tx({payment(root, 1)});
+            gap->getEnvelope().tx.seqNum += 5;
+            txSet->add(valid);
+            txSet->add(gap);
+            txSet->sortForHash();
+            REQUIRE(!txSet->checkValid(*app));
+
+            std::vector<TransactionFramePtr> removed;
+            txSet->trimInvalid(*app, removed);
+            REQUIRE(removed == std::vector<TransactionFramePtr>{gap});
+            REQUIRE(txSet->mTransactions.size() ==
+                    nbAccounts * nbTransactions + 1);
+            REQUIRE(txSet->checkValid(*app));
+        }
         SECTION("insuficient balance")
         {
             // extra transaction would push the account below the reserve
@@ -483,6 +550,54 @@ TEST_CASE("surge", "[herder]")
     }
 }
 
+TEST_CASE("surge pricing benchmark", "[herder][bench][!hide]")
+{
+    Config cfg(getTestConfig());
+    cfg.TESTING_UPGRADE_MAX_TX_PER_LEDGER = 1000;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    lm.getCurrentLedgerHeader().maxTxSetSize =
+        cfg.TESTING_UPGRADE_MAX_TX_PER_LEDGER;
+
+    auto dest = getAccount("dest").getPublicKey();
+    std::vector<SecretKey> accounts;
+    for (int i = 0; i < 1000; i++)
+    {
+        accounts.emplace_back(SecretKey::random());
+    }
+
+    for (size_t n : {10000, 30000, 100000})
+    {
+        TxSetFrame txSet(lm.getLastClosedLedgerHeader().hash);
+        for (size_t i = 0; i < n; i++)
+        {
+            auto const& account = accounts[i % accounts.size()];
+            auto tx = transactionFromOperations(
+                *app, account, i / accounts.size() + 1, {payment(dest, 1)});
+            tx->getEnvelope().tx.fee =
+                static_cast<uint32_t>(lm.getTxFee() * (1 + rand() % 10));
+            txSet.add(tx);
+        }
+        txSet.sortForHash();
+
+        auto start = std::chrono::steady_clock::now();
+        txSet.surgePricingFilter(lm);
+        auto end = std::chrono::steady_clock::now();
+
+        REQUIRE(txSet.size() == cfg.TESTING_UPGRADE_MAX_TX_PER_LEDGER);
+        LOG(INFO) << "surge pricing " << n << " transactions: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         end - start)
+                         .count()
+                  << " ms";
+    }
+}
+
 TEST_CASE("SCP Driver", "[herder]")
 {
     Config cfg(getTestConfig());
@@ -376,6 +376,21 @@ PendingEnvelopes::pop(uint64 slotIndex, SCPEnvelope& ret)
     return false;
 }
 
+std::vector<SCPEnvelope const*>
+PendingEnvelopes::readyEnvelopes(uint64 slotIndex) const
+{
+    std::vector<SCPEnvelope const*> result;
+    for (auto it = mEnvelopes.begin();
+         it != mEnvelopes.end() && slotIndex >= it->first; ++it)
+    {
+        for (auto const& e : it->second.mReadyEnvelopes)
+        {
+            result.push_back(&e);
+        }
+    }
+    return result;
+}
+
 vector<uint64>
 PendingEnvelopes::readySlots()
 {
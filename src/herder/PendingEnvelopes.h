@@ -122,6 +122,9 @@ class PendingEnvelopes
 
     bool pop(uint64 slotIndex, SCPEnvelope& ret);
 
+    // envelopes that pop would return for slots up to slotIndex
+    std::vector<SCPEnvelope const*> readyEnvelopes(uint64 slotIndex) const;
+
     void eraseBelow(uint64 slotIndex);
 
     void slotClosed(uint64 slotIndex);
@@ -0,0 +1,216 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TransactionQueue.h"
+#include "util/XDROperators.h"
+
+#include <algorithm>
+
+namespace stellar
+{
+
+TransactionQueue::TransactionQueue(uint32_t maxAge)
+    : mMaxAge(maxAge), mSizeByAge(maxAge, 0)
+{
+}
+
+bool
+TransactionQueue::FeeKey::operator<(FeeKey const& other) const
+{
+    // mFee / mOps > other.mFee / other.mOps, operation counts are positive
+    auto l = mFee * other.mOps;
+    auto r = other.mFee * mOps;
+    if (l != r)
+    {
+        return l > r;
+    }
+    return mAccount < other.mAccount;
+}
+
+TransactionQueue::FeeKey
+TransactionQueue::getFeeKey(TransactionFrame const& tx)
+{
+    // same operation count as TransactionFrame::getMinFee
+    auto ops = std::max<size_t>(tx.getEnvelope().tx.operations.size(), 1);
+    return FeeKey{tx.getFee(), static_cast<int64_t>(ops), tx.getSourceID()};
+}
+
+bool
+TransactionQueue::add(TransactionFramePtr tx)
+{
+    auto const& h = tx->getFullHash();
+    if (!mByHash.emplace(h, tx).second)
+    {
+        return false;
+    }
+
+    auto it = mAccounts.find(tx->getSourceID());
+    if (it == mAccounts.end())
+    {
+        it = mAccounts.emplace(tx->getSourceID(), AccountTxs{}).first;
+    }
+    else
+    {
+        mByFee.erase(it->second.mFeeKey);
+    }
+    it->second.mTransactions.emplace_back(tx);
+    it->second.mAges.emplace_back(0);
+    mSizeByAge[0]++;
+    update(it);
+    return true;
+}
+
+void
+TransactionQueue::remove(std::vector<TransactionFramePtr> const& txs)
+{
+    for (auto const& tx : txs)
+    {
+        if (mByHash.erase(tx->getFullHash()) == 0)
+        {
+            continue;
+        }
+
+        auto it = mAccounts.find(tx->getSourceID());
+        auto& account = it->second;
+        for (size_t i = 0; i < account.mTransactions.size(); i++)
+        {
+            if (account.mTransactions[i]->getFullHash() == tx->getFullHash())
+            {
+                mSizeByAge[account.mAges[i]]--;
+                account.mTransactions.erase(account.mTransactions.begin() +
+                                            i);
+                account.mAges.erase(account.mAges.begin() + i);
+                break;
+            }
+        }
+        mByFee.erase(account.mFeeKey);
+        update(it);
+    }
+}
+
+bool
+TransactionQueue::contains(Hash const& fullHash) const
+{
+    return mByHash.find(fullHash) != mByHash.end();
+}
+
+TransactionFramePtr
+TransactionQueue::getTx(Hash const& fullHash) const
+{
+    auto it = mByHash.find(fullHash);
+    return it == mByHash.end() ? nullptr : it->second;
+}
+
+SequenceNumber
+TransactionQueue::getMaxSeq(AccountID const& account) const
+{
+    auto it = mAccounts.find(account);
+    return it == mAccounts.end() ? 0 : it->second.mMaxSeq;
+}
+
+int64_t
+TransactionQueue::getTotalFees(AccountID const& account) const
+{
+    auto it = mAccounts.find(account);
+    return it == mAccounts.end() ? 0 : it->second.mTotalFees;
+}
+
+void
+TransactionQueue::shift()
+{
+    for (auto it = mAccounts.begin(); it != mAccounts.end();)
+    {
+        auto next = std::next(it);
+        auto& account = it->second;
+
+        size_t j = 0;
+        for (size_t i = 0; i < account.mTransactions.size(); i++)
+        {
+            auto age = account.mAges[i] + 1;
+            if (age < mMaxAge)
+            {
+                account.mTransactions[j] = account.mTransactions[i];
+                account.mAges[j] = age;
+                j++;
+            }
+            else
+            {
+                mByHash.erase(account.mTransactions[i]->getFullHash());
+            }
+        }
+
+        if (j != account.mTransactions.size())
+        {
+            account.mTransactions.resize(j);
+            account.mAges.resize(j);
+            mByFee.erase(account.mFeeKey);
+            update(it);
+        }
+        it = next;
+    }
+
+    mSizeByAge.insert(mSizeByAge.begin(), 0);
+    mSizeByAge.pop_back();
+}
+
+void
+TransactionQueue::update(std::unordered_map<AccountID, AccountTxs>::iterator it)
+{
+    auto& account = it->second;
+    if (account.mTransactions.empty())
+    {
+        mAccounts.erase(it);
+        return;
+    }
+
+    account.mMaxSeq = 0;
+    account.mTotalFees = 0;
+    account.mFeeKey = getFeeKey(*account.mTransactions.front());
+    for (auto const& tx : account.mTransactions)
+    {
+        account.mMaxSeq = std::max(tx->getSeqNum(), account.mMaxSeq);
+        account.mTotalFees += tx->getFee();
+        auto key = getFeeKey(*tx);
+        // the account is ranked by its cheapest transaction
+        if (account.mFeeKey < key)
+        {
+            account.mFeeKey = key;
+        }
+    }
+    mByFee.insert(account.mFeeKey);
+}
+
+void
+TransactionQueue::forEachAccountByFee(
+    std::function<bool(std::vector<TransactionFramePtr> const&)> const& f)
+    const
+{
+    for (auto const& key : mByFee)
+    {
+        if (!f(mAccounts.at(key.mAccount).mTransactions))
+        {
+            return;
+        }
+    }
+}
+
+std::vector<TransactionFramePtr>
+TransactionQueue::getTransactions() const
+{
+    std::vector<TransactionFramePtr> res;
+    res.reserve(mByHash.size());
+    for (auto const& account : mAccounts)
+    {
+        res.insert(res.end(), account.second.mTransactions.begin(),
+                   account.second.mTransactions.end());
+    }
+    return res;
+}
+
+size_t
+TransactionQueue::sizeByAge(uint32_t age) const
+{
+    return mSizeByAge.at(age);
+}
+}
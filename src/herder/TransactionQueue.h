@@ -0,0 +1,108 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "transactions/TransactionFrame.h"
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace stellar
+{
+
+/*
+TransactionQueue
+Transactions received by the herder that did not make it into a ledger yet.
+
+Transactions are kept per source account, in the order they were added
+(which is sequence number order, as recvTransaction only accepts the next
+sequence number of an account). On top of that the queue keeps:
+  * an index by full hash, to detect duplicates;
+  * an index of the accounts by the lowest fee per operation among their
+    transactions, which is the order surge pricing keeps transactions in,
+    so the transactions most likely to make it into a ledger can be picked
+    without looking at the whole queue.
+
+Every transaction has an age, the number of ledgers closed since it was
+added; transactions that reach `maxAge` are evicted.
+*/
+class TransactionQueue : NonMovableOrCopyable
+{
+  public:
+    explicit TransactionQueue(uint32_t maxAge);
+
+    // returns false if the transaction is already in the queue
+    bool add(TransactionFramePtr tx);
+    void remove(std::vector<TransactionFramePtr> const& txs);
+
+    bool contains(Hash const& fullHash) const;
+    TransactionFramePtr getTx(Hash const& fullHash) const;
+
+    // highest sequence number and total fees of the transactions of an
+    // account, or 0 if the account has no transactions in the queue
+    SequenceNumber getMaxSeq(AccountID const& account) const;
+    int64_t getTotalFees(AccountID const& account) const;
+
+    // increases the age of every transaction, evicting the ones that reached
+    // the maximum age
+    void shift();
+
+    // calls `f` with the transactions of each account, starting with the
+    // account paying the highest fee per operation (ties are broken by
+    // account id), until `f` returns false
+    void forEachAccountByFee(
+        std::function<bool(std::vector<TransactionFramePtr> const&)> const& f)
+        const;
+
+    std::vector<TransactionFramePtr> getTransactions() const;
+
+    size_t
+    size() const
+    {
+        return mByHash.size();
+    }
+
+    // number of transactions of the given age
+    size_t sizeByAge(uint32_t age) const;
+
+  private:
+    // the lowest fee per operation of an account, compared without
+    // converting to floating point
+    struct FeeKey
+    {
+        int64_t mFee;
+        int64_t mOps;
+        AccountID mAccount;
+
+        bool operator<(FeeKey const& other) const;
+    };
+
+    struct AccountTxs
+    {
+        std::vector<TransactionFramePtr> mTransactions;
+        std::vector<uint32_t> mAges;
+        SequenceNumber mMaxSeq{0};
+        int64_t mTotalFees{0};
+        FeeKey mFeeKey;
+    };
+
+    uint32_t const mMaxAge;
+    std::unordered_map<AccountID, AccountTxs> mAccounts;
+    std::unordered_map<Hash, TransactionFramePtr> mByHash;
+    std::set<FeeKey> mByFee;
+    std::vector<size_t> mSizeByAge;
+
+    static FeeKey getFeeKey(TransactionFrame const& tx);
+
+    // recomputes the summary of an account after its transactions changed,
+    // dropping it if it has none left
+    void update(std::unordered_map<AccountID, AccountTxs>::iterator it);
+};
+}
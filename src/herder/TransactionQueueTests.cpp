@@ -0,0 +1,117 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TransactionQueue.h"
+#include "ledger/LedgerManager.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+
+using namespace stellar;
+using namespace stellar::txtest;
+
+TEST_CASE("transaction queue", "[herder][queue]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = app->getLedgerManager().getMinBalance(0);
+    auto a = root.create("A", minBalance * 10);
+    auto b = root.create("B", minBalance * 10);
+    auto c = root.create("C", minBalance * 10);
+
+    auto makeTx = [&](TestAccount& account, uint32_t fee, int ops) {
+        std::vector<Operation> operations(ops, payment(root, 1));
+        auto tx = account.tx(operations);
+        tx->getEnvelope().tx.fee = fee;
+        return tx;
+    };
+
+    TransactionQueue queue(4);
+
+    SECTION("duplicates and per account summary")
+    {
+        auto tx1 = makeTx(a, 100, 1);
+        auto tx2 = makeTx(a, 300, 2);
+        REQUIRE(queue.add(tx1));
+        REQUIRE(queue.add(tx2));
+        REQUIRE(!queue.add(tx1));
+        REQUIRE(queue.size() == 2);
+        REQUIRE(queue.contains(tx1->getFullHash()));
+        REQUIRE(queue.getTx(tx2->getFullHash()) == tx2);
+
+        REQUIRE(queue.getMaxSeq(a) == tx2->getSeqNum());
+        REQUIRE(queue.getTotalFees(a) == 400);
+        REQUIRE(queue.getMaxSeq(b) == 0);
+        REQUIRE(queue.getTotalFees(b) == 0);
+
+        queue.remove({tx2});
+        REQUIRE(queue.size() == 1);
+        REQUIRE(!queue.contains(tx2->getFullHash()));
+        REQUIRE(queue.getMaxSeq(a) == tx1->getSeqNum());
+        REQUIRE(queue.getTotalFees(a) == 100);
+
+        queue.remove({tx1});
+        REQUIRE(queue.size() == 0);
+        REQUIRE(queue.getMaxSeq(a) == 0);
+    }
+
+    SECTION("accounts ordered by fee per operation")
+    {
+        // a pays 100 per operation, its cheapest transaction
+        queue.add(makeTx(a, 1000, 1));
+        queue.add(makeTx(a, 200, 2));
+        // b pays 150 per operation
+        queue.add(makeTx(b, 300, 2));
+        // c pays 400 per operation
+        queue.add(makeTx(c, 400, 1));
+
+        std::vector<size_t> counts;
+        queue.forEachAccountByFee(
+            [&](std::vector<TransactionFramePtr> const& txs) {
+                counts.emplace_back(txs.size());
+                return true;
+            });
+        REQUIRE(counts == std::vector<size_t>{1, 1, 2});
+
+        std::vector<AccountID> accounts;
+        queue.forEachAccountByFee(
+            [&](std::vector<TransactionFramePtr> const& txs) {
+                accounts.emplace_back(txs.front()->getSourceID());
+                return accounts.size() < 2;
+            });
+        REQUIRE(accounts ==
+                std::vector<AccountID>{c.getPublicKey(), b.getPublicKey()});
+    }
+
+    SECTION("eviction by age")
+    {
+        auto tx1 = makeTx(a, 100, 1);
+        queue.add(tx1);
+        queue.shift();
+        queue.shift();
+        auto tx2 = makeTx(a, 100, 1);
+        queue.add(tx2);
+        REQUIRE(queue.sizeByAge(0) == 1);
+        REQUIRE(queue.sizeByAge(2) == 1);
+
+        queue.shift();
+        REQUIRE(queue.size() == 2);
+        queue.shift();
+        REQUIRE(queue.size() == 1);
+        REQUIRE(!queue.contains(tx1->getFullHash()));
+        REQUIRE(queue.getMaxSeq(a) == tx2->getSeqNum());
+        REQUIRE(queue.sizeByAge(2) == 1);
+
+        queue.shift();
+        queue.shift();
+        REQUIRE(queue.size() == 0);
+        REQUIRE(queue.getTransactions().empty());
+    }
+}
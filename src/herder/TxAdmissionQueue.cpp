@@ -0,0 +1,185 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TxAdmissionQueue.h"
+#include "crypto/KeyUtils.h"
+#include "crypto/SignerKey.h"
+#include "main/Application.h"
+#include "transactions/SignatureUtils.h"
+#include "transactions/TransactionFrame.h"
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <set>
+
+namespace stellar
+{
+
+TxAdmissionQueue::TxAdmissionQueue(Application& app, Admit admit,
+                                   size_t maxSize)
+    : mApp(app)
+    , mAdmit(std::move(admit))
+    , mMaxSize(maxSize)
+    , mQueueSize(
+          app.getMetrics().NewCounter({"herder", "admission", "queue"}))
+    , mRejectMeter(app.getMetrics().NewMeter(
+          {"herder", "admission", "reject"}, "transaction"))
+    , mCheckTimer(
+          app.getMetrics().NewTimer({"herder", "admission", "check"}))
+    , mWaitTimer(app.getMetrics().NewTimer({"herder", "admission", "wait"}))
+    , mAdmitTimer(
+          app.getMetrics().NewTimer({"herder", "admission", "admit"}))
+{
+}
+
+void
+TxAdmissionQueue::add(TransactionFramePtr tx, Callback done)
+{
+    auto entry = std::make_shared<Entry>();
+    entry->mTx = tx;
+    entry->mDone = std::move(done);
+    enqueue({entry});
+}
+
+void
+TxAdmissionQueue::add(std::vector<TransactionFramePtr> const& txs,
+                      BatchCallback done)
+{
+    std::vector<std::shared_ptr<Entry>> entries;
+    entries.reserve(txs.size());
+    for (auto const& tx : txs)
+    {
+        auto entry = std::make_shared<Entry>();
+        entry->mTx = tx;
+        entry->mDone = [done, tx](Herder::TransactionSubmitStatus status) {
+            done(tx, status);
+        };
+        entries.emplace_back(entry);
+    }
+    enqueue(std::move(entries));
+}
+
+void
+TxAdmissionQueue::enqueue(std::vector<std::shared_ptr<Entry>> entries)
+{
+    if (entries.empty())
+    {
+        return;
+    }
+
+    // the entries are only referenced weakly from the other threads: if the
+    // queue goes away in the meantime, there is nothing left to do
+    std::vector<std::weak_ptr<Entry>> weak;
+    std::vector<TransactionFramePtr> txs;
+    weak.reserve(entries.size());
+    txs.reserve(entries.size());
+    auto now = std::chrono::steady_clock::now();
+    for (auto& e : entries)
+    {
+        if (mEntries.size() >= mMaxSize)
+        {
+            mRejectMeter.Mark();
+            e->mDone(Herder::TX_STATUS_ERROR);
+            continue;
+        }
+        e->mReceived = now;
+        weak.emplace_back(e);
+        txs.emplace_back(e->mTx);
+        mEntries.emplace_back(std::move(e));
+    }
+    mQueueSize.set_count(mEntries.size());
+    if (txs.empty())
+    {
+        return;
+    }
+
+    auto& app = mApp;
+    mApp.getWorkerIOService().post([this, weak, txs, &app]() {
+        std::vector<std::chrono::nanoseconds> durations;
+        durations.reserve(txs.size());
+        for (auto const& tx : txs)
+        {
+            auto start = std::chrono::steady_clock::now();
+            check(*tx);
+            durations.emplace_back(std::chrono::steady_clock::now() - start);
+        }
+
+        app.getClock().getIOService().post([this, weak, durations]() {
+            bool any = false;
+            for (size_t i = 0; i < weak.size(); i++)
+            {
+                auto e = weak[i].lock();
+                if (e)
+                {
+                    e->mCheckDuration = durations[i];
+                    e->mChecked = true;
+                    any = true;
+                }
+            }
+            if (any)
+            {
+                process();
+            }
+        });
+    });
+}
+
+void
+TxAdmissionQueue::check(TransactionFrame& tx)
+{
+    // caches both hashes in the frame
+    tx.getFullHash();
+    auto const& contentsHash = tx.getContentsHash();
+
+    auto const& env = tx.getEnvelope();
+    std::set<PublicKey> sources;
+    sources.insert(tx.getSourceID());
+    for (auto const& op : env.tx.operations)
+    {
+        if (op.sourceAccount)
+        {
+            sources.insert(*op.sourceAccount);
+        }
+    }
+
+    // other signers are only known once the accounts are loaded, their
+    // signatures are checked on the main thread
+    for (auto const& sig : env.signatures)
+    {
+        for (auto const& source : sources)
+        {
+            if (SignatureUtils::doesHintMatch(source.ed25519(), sig.hint))
+            {
+                SignatureUtils::verify(
+                    sig, KeyUtils::convertKey<SignerKey>(source),
+                    contentsHash);
+            }
+        }
+    }
+}
+
+void
+TxAdmissionQueue::process()
+{
+    while (!mEntries.empty() && mEntries.front()->mChecked)
+    {
+        auto entry = mEntries.front();
+        mEntries.pop_front();
+        mQueueSize.set_count(mEntries.size());
+
+        mCheckTimer.Update(entry->mCheckDuration);
+        mWaitTimer.Update(std::chrono::steady_clock::now() - entry->mReceived);
+
+        Herder::TransactionSubmitStatus status;
+        {
+            auto timer = mAdmitTimer.TimeScope();
+            status = mAdmit(entry->mTx);
+        }
+        entry->mDone(status);
+    }
+}
+}
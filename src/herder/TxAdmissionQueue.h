@@ -0,0 +1,102 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/Herder.h"
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+class Application;
+
+// transactions waiting for admission; a burst beyond that is rejected
+static size_t const TX_ADMISSION_QUEUE_MAX_SIZE = 10000;
+
+/*
+TxAdmissionQueue
+Pipeline for the transactions received from the network.
+
+Work that does not depend on the ledger (hashing the transaction, checking
+the signatures made by its source accounts' master keys) is done on the
+worker threads; the results of signature checks land in the verification
+cache. The rest of the validation (sequence numbers, balances, signer
+weights) needs the database and is done on the main thread by `admit`,
+which also inserts the transaction into the pending set.
+
+Transactions are admitted in the order they were added, so that a burst of
+transactions from one account is not rejected because the worker threads
+finished them out of order.
+
+The queue is bounded: transactions added while it is full are rejected right
+away with TX_STATUS_ERROR, without being checked.
+*/
+class TxAdmissionQueue : NonMovableOrCopyable
+{
+  public:
+    typedef std::function<Herder::TransactionSubmitStatus(TransactionFramePtr)>
+        Admit;
+    typedef std::function<void(Herder::TransactionSubmitStatus)> Callback;
+    typedef std::function<void(TransactionFramePtr const&,
+                               Herder::TransactionSubmitStatus)>
+        BatchCallback;
+
+    TxAdmissionQueue(Application& app, Admit admit,
+                     size_t maxSize = TX_ADMISSION_QUEUE_MAX_SIZE);
+
+    // `done` is called on the main thread once `tx` went through `admit`,
+    // or right away if the queue is full
+    void add(TransactionFramePtr tx, Callback done);
+    // same for a batch of transactions, checked by a single worker task;
+    // `done` is called for each transaction, in order (rejected ones first)
+    void add(std::vector<TransactionFramePtr> const& txs, BatchCallback done);
+
+    size_t
+    size() const
+    {
+        return mEntries.size();
+    }
+
+  private:
+    struct Entry
+    {
+        TransactionFramePtr mTx;
+        Callback mDone;
+        std::chrono::steady_clock::time_point mReceived;
+        std::chrono::nanoseconds mCheckDuration{0};
+        bool mChecked{false};
+    };
+
+    Application& mApp;
+    Admit mAdmit;
+    size_t const mMaxSize;
+    std::deque<std::shared_ptr<Entry>> mEntries;
+
+    medida::Counter& mQueueSize;
+    medida::Meter& mRejectMeter;
+    medida::Timer& mCheckTimer;
+    medida::Timer& mWaitTimer;
+    medida::Timer& mAdmitTimer;
+
+    // runs on a worker thread
+    static void check(TransactionFrame& tx);
+
+    void enqueue(std::vector<std::shared_ptr<Entry>> entries);
+
+    void process();
+};
+}
@@ -0,0 +1,67 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TxAdmissionQueue.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionFrame.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+using namespace stellar;
+using namespace stellar::txtest;
+
+TEST_CASE("transaction admission queue", "[herder][queue]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+
+    std::vector<TransactionFramePtr> admitted;
+    TxAdmissionQueue queue(*app,
+                           [&](TransactionFramePtr tx) {
+                               admitted.emplace_back(tx);
+                               return Herder::TX_STATUS_PENDING;
+                           },
+                           2);
+
+    std::vector<TransactionFramePtr> txs;
+    for (int i = 0; i < 3; i++)
+    {
+        txs.emplace_back(root.tx({payment(root, 1)}));
+    }
+
+    std::vector<std::pair<TransactionFramePtr, Herder::TransactionSubmitStatus>>
+        done;
+    queue.add(txs, [&](TransactionFramePtr const& tx,
+                       Herder::TransactionSubmitStatus status) {
+        done.emplace_back(tx, status);
+    });
+
+    // the last one did not fit
+    REQUIRE(queue.size() == 2);
+    REQUIRE(done.size() == 1);
+    REQUIRE(done[0].first == txs[2]);
+    REQUIRE(done[0].second == Herder::TX_STATUS_ERROR);
+    REQUIRE(app->getMetrics()
+                .NewMeter({"herder", "admission", "reject"}, "transaction")
+                .count() == 1);
+
+    while (done.size() < 3)
+    {
+        clock.crank(true);
+    }
+    REQUIRE(queue.size() == 0);
+    REQUIRE(admitted == std::vector<TransactionFramePtr>{txs[0], txs[1]});
+    REQUIRE(done[1].first == txs[0]);
+    REQUIRE(done[2].first == txs[1]);
+    REQUIRE(done[1].second == Herder::TX_STATUS_PENDING);
+}
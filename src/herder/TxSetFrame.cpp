@@ -6,14 +6,19 @@
 #include "TxSetFrame.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "util/Logging.h"
+#include "util/Parallel.h"
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 #include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "xdrpp/printer.h"
 
@@ -132,25 +137,20 @@ TxSetFrame::sortForApply()
     return retList;
 }
 
-struct SurgeSorter
-{
-    map<AccountID, double>& mAccountFeeMap;
-    SurgeSorter(map<AccountID, double>& afm) : mAccountFeeMap(afm)
-    {
-    }
+// transactions with the fee ratio of their account
+typedef std::pair<double, TransactionFramePtr> SurgeEntry;
 
-    bool
-    operator()(TransactionFramePtr const& tx1, TransactionFramePtr const& tx2)
-    {
-        if (tx1->getSourceID() == tx2->getSourceID())
-            return tx1->getSeqNum() < tx2->getSeqNum();
-        double fee1 = mAccountFeeMap[tx1->getSourceID()];
-        double fee2 = mAccountFeeMap[tx2->getSourceID()];
-        if (fee1 == fee2)
-            return tx1->getSourceID() < tx2->getSourceID();
-        return fee1 > fee2;
-    }
-};
+static bool
+SurgeSorter(SurgeEntry const& e1, SurgeEntry const& e2)
+{
+    auto const& tx1 = e1.second;
+    auto const& tx2 = e2.second;
+    if (tx1->getSourceID() == tx2->getSourceID())
+        return tx1->getSeqNum() < tx2->getSeqNum();
+    if (e1.first == e2.first)
+        return tx1->getSourceID() < tx2->getSourceID();
+    return e1.first > e2.first;
+}
 
 void
 TxSetFrame::surgePricingFilter(LedgerManager const& lm)
@@ -162,26 +162,41 @@ TxSetFrame::surgePricingFilter(LedgerManager const& lm)
             << "surge pricing in effect! " << mTransactions.size();
 
         // determine the fee ratio for each account
-        map<AccountID, double> accountFeeMap;
+        unordered_map<AccountID, double> accountFeeMap;
         for (auto& tx : mTransactions)
         {
             double r = tx->getFeeRatio(lm);
-            double now = accountFeeMap[tx->getSourceID()];
-            if (now == 0)
-                accountFeeMap[tx->getSourceID()] = r;
-            else if (r < now)
-                accountFeeMap[tx->getSourceID()] = r;
+            auto res = accountFeeMap.emplace(tx->getSourceID(), r);
+            if (!res.second && r < res.first->second)
+                res.first->second = r;
         }
 
-        // sort tx by amount of fee they have paid
-        // remove the bottom that aren't paying enough
-        std::vector<TransactionFramePtr> tempList = mTransactions;
-        std::sort(tempList.begin(), tempList.end(), SurgeSorter(accountFeeMap));
+        // select the transactions paying the most, the order within an
+        // account is by sequence number so only a prefix of each account's
+        // transactions is kept
+        std::vector<SurgeEntry> entries;
+        entries.reserve(mTransactions.size());
+        for (auto& tx : mTransactions)
+        {
+            entries.emplace_back(accountFeeMap[tx->getSourceID()], tx);
+        }
+        std::nth_element(entries.begin(), entries.begin() + max,
+                         entries.end(), SurgeSorter);
 
-        for (auto iter = tempList.begin() + max; iter != tempList.end(); iter++)
+        unordered_set<TransactionFrame const*> kept;
+        for (auto it = entries.begin(); it != entries.begin() + max; ++it)
         {
-            removeTx(*iter);
+            kept.insert(it->second.get());
         }
+
+        // keep the remaining transactions in the order they were
+        mTransactions.erase(
+            std::remove_if(mTransactions.begin(), mTransactions.end(),
+                           [&kept](TransactionFramePtr const& tx) {
+                               return kept.find(tx.get()) == kept.end();
+                           }),
+            mTransactions.end());
+        mHashIsValid = false;
     }
 }
 
@@ -193,6 +208,15 @@ TxSetFrame::checkOrTrim(
     std::function<bool(std::vector<TransactionFramePtr> const&)>
         processInsufficientBalance)
 {
+    // serializing and hashing the transactions does not depend on the
+    // ledger, do it on the worker threads
+    parallelFor(app.getWorkerIOService(), std::thread::hardware_concurrency(),
+                mTransactions.size(), [this](size_t i) {
+                    auto const& tx = mTransactions[i];
+                    tx->getFullHash();
+                    tx->getContentsHash();
+                });
+
     map<AccountID, vector<TransactionFramePtr>> accountTxMap;
 
     Hash lastHash;
@@ -209,19 +233,57 @@ TxSetFrame::checkOrTrim(
         lastHash = tx->getFullHash();
     }
 
+    auto accounts =
+        TransactionFrame::prefetchAccounts(mTransactions, app.getDatabase());
+    TransactionFrame::preVerifySignatures(mTransactions, app);
+
+    // transactions of an account depend on each other through their sequence
+    // numbers but accounts do not depend on each other; they are validated
+    // on the worker threads against the prefetched accounts, the callbacks
+    // are then run here in order
+    struct TxCheck
+    {
+        bool mValid;
+        SequenceNumber mLastSeq;
+    };
+    vector<vector<TransactionFramePtr>*> accountTxs;
+    accountTxs.reserve(accountTxMap.size());
+    for (auto& item : accountTxMap)
+    {
+        accountTxs.emplace_back(&item.second);
+    }
+    vector<vector<TxCheck>> checks(accountTxs.size());
+    parallelFor(app.getWorkerIOService(), std::thread::hardware_concurrency(),
+                accountTxs.size(), [&](size_t i) {
+                    auto& txs = *accountTxs[i];
+                    // order by sequence number
+                    std::sort(txs.begin(), txs.end(), SeqSorter);
+
+                    SequenceNumber lastSeq = 0;
+                    for (auto& tx : txs)
+                    {
+                        bool valid = tx->checkValid(app, lastSeq, accounts);
+                        checks[i].push_back({valid, lastSeq});
+                        if (valid)
+                        {
+                            lastSeq = tx->getSeqNum();
+                        }
+                    }
+                });
+
+    size_t i = 0;
     for (auto& item : accountTxMap)
     {
-        // order by sequence number
-        std::sort(item.second.begin(), item.second.end(), SeqSorter);
+        auto const& results = checks[i++];
 
         TransactionFramePtr lastTx;
-        SequenceNumber lastSeq = 0;
         int64_t totFee = 0;
-        for (auto& tx : item.second)
+        for (size_t j = 0; j < item.second.size(); j++)
         {
-            if (!tx->checkValid(app, lastSeq))
+            auto& tx = item.second[j];
+            if (!results[j].mValid)
             {
-                if (processInvalidTxLambda(tx, lastSeq))
+                if (processInvalidTxLambda(tx, results[j].mLastSeq))
                     continue;
 
                 return false;
@@ -229,7 +291,6 @@ TxSetFrame::checkOrTrim(
             totFee += tx->getFee();
 
             lastTx = tx;
-            lastSeq = tx->getSeqNum();
         }
         if (lastTx)
         {
@@ -348,7 +409,7 @@ TxSetFrame::getContentsHash()
         hasher->add(mPreviousLedgerHash);
         for (unsigned int n = 0; n < mTransactions.size(); n++)
         {
-            hasher->add(xdr::xdr_to_opaque(mTransactions[n]->getEnvelope()));
+            hasher->add(mTransactions[n]->getEnvelopeBytes());
         }
         mHash = hasher->finish();
         mHashIsValid = true;
@@ -22,6 +22,9 @@ using namespace std;
 
 namespace stellar
 {
+const size_t AccountFrame::kLoadAccountsBatchSize = 256;
+const int64 AccountFrame::kInflationVoteMinBalance = 1000000000;
+
 const char* AccountFrame::kSQLCreateStatement1 =
     "CREATE TABLE accounts"
     "("
@@ -53,6 +56,16 @@ const char* AccountFrame::kSQLCreateStatement4 = "CREATE INDEX accountbalances "
                                                  "ON accounts (balance) WHERE "
                                                  "balance >= 1000000000";
 
+const char* AccountFrame::kSQLCreateStatement5 =
+    "CREATE TABLE inflationvotes"
+    "("
+    "inflationdest   VARCHAR(56) PRIMARY KEY,"
+    "votes           BIGINT      NOT NULL CHECK (votes >= 0)"
+    ");";
+
+const char* AccountFrame::kSQLCreateStatement6 =
+    "CREATE INDEX inflationvotesbyvotes ON inflationvotes (votes)";
+
 AccountFrame::AccountFrame()
     : EntryFrame(ACCOUNT), mAccountEntry(mEntry.data.account())
 {
@@ -232,20 +245,20 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
         return p ? std::make_shared<AccountFrame>(*p) : nullptr;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(accountID);
 
-    std::string publicKey, inflationDest, creditAuthKey;
-    std::string homeDomain, thresholds;
+    std::string inflationDest, homeDomain, thresholds;
     soci::indicator inflationDestInd;
+    int hasSigners = 0;
 
     AccountFrame::pointer res = make_shared<AccountFrame>(accountID);
     AccountEntry& account = res->getAccount();
 
-    auto prep =
-        db.getPreparedStatement("SELECT accounttype, balance, seqnum, numsubentries, "
-                                "inflationdest, homedomain, thresholds, "
-                                "flags, lastmodified "
-                                "FROM accounts WHERE accountid=:v1");
+    auto prep = db.getPreparedStatement(
+        "SELECT accounttype, balance, seqnum, numsubentries, "
+        "inflationdest, homedomain, thresholds, "
+        "flags, lastmodified, hassigners "
+        "FROM accounts WHERE accountid=:v1");
     auto& st = prep.statement();
     st.exchange(into(account.accountType));
     st.exchange(into(account.balance));
@@ -256,6 +269,7 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     st.exchange(into(thresholds));
     st.exchange(into(account.flags));
     st.exchange(into(res->getLastModified()));
+    st.exchange(into(hasSigners));
     st.exchange(use(actIDStrKey));
     st.define_and_bind();
     {
@@ -268,20 +282,12 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
         return nullptr;
     }
 
-    account.homeDomain = homeDomain;
-
-    decoder::decode_b64(thresholds.begin(), thresholds.end(),
-                        res->mAccountEntry.thresholds.begin());
-
-    if (inflationDestInd == soci::i_ok)
-    {
-        account.inflationDest.activate() =
-            KeyUtils::fromStrKey<PublicKey>(inflationDest);
-    }
+    loadAccountColumns(account, inflationDestInd == soci::i_ok, inflationDest,
+                       homeDomain, thresholds);
 
     account.signers.clear();
 
-    if (account.numSubEntries != 0)
+    if (hasSigners != 0)
     {
         auto signers = loadSigners(db, actIDStrKey);
         account.signers.insert(account.signers.begin(), signers.begin(),
@@ -295,6 +301,184 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     return res;
 }
 
+void
+AccountFrame::loadAccountColumns(AccountEntry& account, bool hasInflationDest,
+                                 std::string const& inflationDest,
+                                 std::string const& homeDomain,
+                                 std::string const& thresholds)
+{
+    account.homeDomain = homeDomain;
+
+    decoder::decode_b64(thresholds.begin(), thresholds.end(),
+                        account.thresholds.begin());
+
+    if (hasInflationDest)
+    {
+        account.inflationDest.activate() =
+            KeyUtils::fromDbKey<PublicKey>(inflationDest);
+    }
+}
+
+std::unordered_map<AccountID, AccountFrame::pointer>
+AccountFrame::loadAccounts(std::vector<AccountID> const& accountIDs,
+                           Database& db)
+{
+    std::unordered_map<AccountID, AccountFrame::pointer> res;
+    std::vector<AccountID> toLoad;
+
+    for (auto const& accountID : accountIDs)
+    {
+        if (res.find(accountID) != res.end())
+        {
+            continue;
+        }
+        LedgerKey key;
+        key.type(ACCOUNT);
+        key.account().accountID = accountID;
+        if (cachedEntryExists(key, db))
+        {
+            auto p = getCachedEntry(key, db);
+            res.emplace(accountID,
+                        p ? std::make_shared<AccountFrame>(*p) : nullptr);
+        }
+        else
+        {
+            res.emplace(accountID, nullptr);
+            toLoad.emplace_back(accountID);
+        }
+    }
+
+    for (auto it = toLoad.cbegin(); it != toLoad.cend();)
+    {
+        auto batchEnd = it + std::min<size_t>(kLoadAccountsBatchSize,
+                                              toLoad.cend() - it);
+        loadAccountsBatch(it, batchEnd, res, db);
+        it = batchEnd;
+    }
+
+    return res;
+}
+
+void
+AccountFrame::loadAccountsBatch(
+    std::vector<AccountID>::const_iterator begin,
+    std::vector<AccountID>::const_iterator end,
+    std::unordered_map<AccountID, AccountFrame::pointer>& res, Database& db)
+{
+    // strkeys only contain base32 characters, so they can be inlined in
+    // the query; the statement is not cached as its text depends on the
+    // number of accounts
+    std::string inList;
+    for (auto it = begin; it != end; ++it)
+    {
+        if (!inList.empty())
+        {
+            inList += ",";
+        }
+        inList += "'" + KeyUtils::toDbKey(*it) + "'";
+    }
+
+    std::vector<std::string> withSigners;
+    {
+        std::string actIDStrKey, inflationDest, homeDomain, thresholds;
+        soci::indicator inflationDestInd;
+        int hasSigners = 0;
+        LedgerEntry le;
+        le.data.type(ACCOUNT);
+        AccountEntry& account = le.data.account();
+
+        soci::statement st =
+            (db.getSession().prepare
+                 << "SELECT accountid, accounttype, balance, seqnum, "
+                    "numsubentries, inflationdest, homedomain, thresholds, "
+                    "flags, lastmodified, hassigners "
+                    "FROM accounts WHERE accountid IN ("
+                 << inList << ")",
+             into(actIDStrKey), into(account.accountType),
+             into(account.balance), into(account.seqNum),
+             into(account.numSubEntries),
+             into(inflationDest, inflationDestInd), into(homeDomain),
+             into(thresholds), into(account.flags),
+             into(le.lastModifiedLedgerSeq), into(hasSigners));
+        {
+            auto timer = db.getSelectTimer("account");
+            st.execute(true);
+        }
+        while (st.got_data())
+        {
+            account.accountID = KeyUtils::fromDbKey<PublicKey>(actIDStrKey);
+            account.inflationDest.reset();
+            loadAccountColumns(account, inflationDestInd == soci::i_ok,
+                               inflationDest, homeDomain, thresholds);
+
+            auto a = std::make_shared<AccountFrame>(le);
+            a->mUpdateSigners = false;
+            res[account.accountID] = a;
+            if (hasSigners != 0)
+            {
+                withSigners.emplace_back(actIDStrKey);
+            }
+            st.fetch();
+        }
+    }
+
+    if (!withSigners.empty())
+    {
+        std::string signersList;
+        for (auto const& id : withSigners)
+        {
+            if (!signersList.empty())
+            {
+                signersList += ",";
+            }
+            signersList += "'" + id + "'";
+        }
+
+        std::string actIDStrKey, pubKey;
+        Signer signer;
+        soci::statement st =
+            (db.getSession().prepare
+                 << "SELECT accountid, publickey, weight FROM signers "
+                    "WHERE accountid IN ("
+                 << signersList << ")",
+             into(actIDStrKey), into(pubKey), into(signer.weight));
+        {
+            auto timer = db.getSelectTimer("signer");
+            st.execute(true);
+        }
+        while (st.got_data())
+        {
+            auto& a = res[KeyUtils::fromDbKey<PublicKey>(actIDStrKey)];
+            if (!a)
+            {
+                throw std::runtime_error(fmt::format(
+                    "Found signers for unknown account {}", actIDStrKey));
+            }
+            signer.key = KeyUtils::fromDbKey<SignerKey>(pubKey);
+            a->mAccountEntry.signers.push_back(signer);
+            st.fetch();
+        }
+    }
+
+    for (auto it = begin; it != end; ++it)
+    {
+        auto& a = res[*it];
+        if (a)
+        {
+            a->normalize();
+            a->mKeyCalculated = false;
+            a->putCachedEntry(db);
+        }
+        else
+        {
+            LedgerKey key;
+            key.type(ACCOUNT);
+            key.account().accountID = *it;
+            putCachedEntry(key, nullptr, db);
+        }
+    }
+}
+
 std::vector<Signer>
 AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
 {
@@ -315,7 +499,7 @@ AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
     }
     while (st2.got_data())
     {
-        signer.key = KeyUtils::fromStrKey<SignerKey>(pubKey);
+        signer.key = KeyUtils::fromDbKey<SignerKey>(pubKey);
         res.push_back(signer);
         st2.fetch();
     }
@@ -333,7 +517,7 @@ AccountFrame::exists(Database& db, LedgerKey const& key)
         return true;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(key.account().accountID);
     int exists = 0;
     {
         auto timer = db.getSelectTimer("account-exists");
@@ -394,6 +578,7 @@ AccountFrame::deleteAccountsModifiedOnOrAfterLedger(Database& db,
         st.define_and_bind();
         st.execute(true);
     }
+    rebuildInflationVotes(db);
 }
 
 void
@@ -406,9 +591,12 @@ void
 AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
                           LedgerKey const& key)
 {
+    InflationVotes oldVote;
+    bool hadVote = loadInflationVote(key, db, oldVote);
+
     flushCachedEntry(key, db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(key.account().accountID);
     {
         auto timer = db.getDeleteTimer("account");
         auto prep = db.getPreparedStatement(
@@ -427,6 +615,7 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
         st.define_and_bind();
         st.execute(true);
     }
+    updateInflationVotes(db, hadVote, oldVote, false, InflationVotes{});
     delta.deleteEntry(key);
 }
 
@@ -435,9 +624,12 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
+    InflationVotes oldVote;
+    bool hadVote = !insert && loadInflationVote(getKey(), db, oldVote);
+
     flushCachedEntry(db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(mAccountEntry.accountID);
     std::string sql;
 
     if (insert)
@@ -445,8 +637,9 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         sql = std::string(
             "INSERT INTO accounts ( accountid, accounttype, balance, seqnum, "
             "numsubentries, inflationdest, homedomain, thresholds, flags, "
-            "lastmodified ) "
-            "VALUES ( :id, :accType, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8 )");
+            "lastmodified, hassigners ) "
+            "VALUES ( :id, :accType, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8, "
+            ":v9 )");
     }
     else
     {
@@ -454,7 +647,8 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
             "UPDATE accounts SET balance = :v1, seqnum = :v2, "
             "numsubentries = :v3, "
             "inflationdest = :v4, homedomain = :v5, thresholds = :v6, "
-            "flags = :v7, lastmodified = :v8 WHERE accountid = :id");
+            "flags = :v7, lastmodified = :v8, hassigners = :v9 "
+            "WHERE accountid = :id");
     }
 
     auto prep = db.getPreparedStatement(sql);
@@ -464,11 +658,12 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     if (mAccountEntry.inflationDest)
     {
-        inflationDestStrKey = KeyUtils::toStrKey(*mAccountEntry.inflationDest);
+        inflationDestStrKey = KeyUtils::toDbKey(*mAccountEntry.inflationDest);
         inflation_ind = soci::i_ok;
     }
 
     string thresholds(decoder::encode_b64(mAccountEntry.thresholds));
+    int hasSigners = mAccountEntry.signers.empty() ? 0 : 1;
 
     {
         soci::statement& st = prep.statement();
@@ -484,6 +679,7 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         st.exchange(use(thresholds, "v6"));
         st.exchange(use(mAccountEntry.flags, "v7"));
         st.exchange(use(getLastModified(), "v8"));
+        st.exchange(use(hasSigners, "v9"));
         st.define_and_bind();
         {
             auto timer = insert ? db.getInsertTimer("account")
@@ -495,6 +691,11 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         {
             throw std::runtime_error("Could not update data in SQL");
         }
+
+        InflationVotes newVote;
+        bool hasVote = getInflationVote(mAccountEntry, newVote);
+        updateInflationVotes(db, hadVote, oldVote, hasVote, newVote);
+
         if (insert)
         {
             delta.addEntry(*this);
@@ -514,7 +715,7 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 void
 AccountFrame::applySigners(Database& db, bool insert)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(mAccountEntry.accountID);
 
     // generates a diff with the signers stored in the database
 
@@ -554,7 +755,7 @@ AccountFrame::applySigners(Database& db, bool insert)
         {
             if (it_new->weight != it_old->weight)
             {
-                std::string signerStrKey = KeyUtils::toStrKey(it_new->key);
+                std::string signerStrKey = KeyUtils::toDbKey(it_new->key);
                 auto timer = db.getUpdateTimer("signer");
                 auto prep2 = db.getPreparedStatement(
                     "UPDATE signers set weight=:v1 WHERE "
@@ -577,7 +778,7 @@ AccountFrame::applySigners(Database& db, bool insert)
         else if (added)
         {
             // signer was added
-            std::string signerStrKey = KeyUtils::toStrKey(it_new->key);
+            std::string signerStrKey = KeyUtils::toDbKey(it_new->key);
 
             auto prep2 = db.getPreparedStatement("INSERT INTO signers "
                                                  "(accountid,publickey,weight) "
@@ -599,7 +800,7 @@ AccountFrame::applySigners(Database& db, bool insert)
         else
         {
             // signer was deleted
-            std::string signerStrKey = KeyUtils::toStrKey(it_old->key);
+            std::string signerStrKey = KeyUtils::toDbKey(it_old->key);
 
             auto prep2 = db.getPreparedStatement("DELETE from signers WHERE "
                                                  "accountid=:v2 AND "
@@ -647,31 +848,201 @@ AccountFrame::processForInflation(
     std::function<bool(AccountFrame::InflationVotes const&)> inflationProcessor,
     int maxWinners, Database& db)
 {
+    if (maxWinners <= 0)
+    {
+        return;
+    }
+
     soci::session& session = db.getSession();
 
     InflationVotes v;
     std::string inflationDest;
 
+    // ties are broken by the StrKey of the destination, which is not the
+    // order in which the compact keys stored in the database sort: load
+    // every destination tied with the last winner and sort here instead
     soci::statement st =
         (session.prepare
              << "SELECT"
-                " sum(balance) AS votes, inflationdest FROM accounts WHERE"
-                " inflationdest IS NOT NULL"
-                " AND balance >= 1000000000 GROUP BY inflationdest"
-                " ORDER BY votes DESC, inflationdest DESC LIMIT :lim",
-         into(v.mVotes), into(inflationDest), use(maxWinners));
+                " votes, inflationdest FROM inflationvotes"
+                " ORDER BY votes DESC",
+         into(v.mVotes), into(inflationDest));
+
+    std::vector<std::pair<InflationVotes, std::string>> winners;
 
     st.execute(true);
 
     while (st.got_data())
     {
-        v.mInflationDest = KeyUtils::fromStrKey<PublicKey>(inflationDest);
-        if (!inflationProcessor(v))
+        if (winners.size() >= static_cast<size_t>(maxWinners) &&
+            v.mVotes < winners.back().first.mVotes)
         {
             break;
         }
+        v.mInflationDest = KeyUtils::fromDbKey<PublicKey>(inflationDest);
+        winners.emplace_back(v, KeyUtils::toStrKey(v.mInflationDest));
         st.fetch();
     }
+
+    std::sort(winners.begin(), winners.end(),
+              [](std::pair<InflationVotes, std::string> const& l,
+                 std::pair<InflationVotes, std::string> const& r) {
+                  if (l.first.mVotes != r.first.mVotes)
+                  {
+                      return l.first.mVotes > r.first.mVotes;
+                  }
+                  return l.second > r.second;
+              });
+    if (winners.size() > static_cast<size_t>(maxWinners))
+    {
+        winners.resize(maxWinners);
+    }
+
+    for (auto const& w : winners)
+    {
+        if (!inflationProcessor(w.first))
+        {
+            break;
+        }
+    }
+}
+
+bool
+AccountFrame::getInflationVote(AccountEntry const& account,
+                               InflationVotes& vote)
+{
+    if (!account.inflationDest || account.balance < kInflationVoteMinBalance)
+    {
+        return false;
+    }
+    vote.mVotes = account.balance;
+    vote.mInflationDest = *account.inflationDest;
+    return true;
+}
+
+bool
+AccountFrame::loadInflationVote(LedgerKey const& key, Database& db,
+                                InflationVotes& vote)
+{
+    if (cachedEntryExists(key, db))
+    {
+        auto p = getCachedEntry(key, db);
+        return p && getInflationVote(p->data.account(), vote);
+    }
+
+    std::string actIDStrKey = KeyUtils::toDbKey(key.account().accountID);
+    std::string inflationDest;
+    soci::indicator inflationDestInd;
+    AccountEntry account;
+
+    auto prep = db.getPreparedStatement(
+        "SELECT balance, inflationdest FROM accounts WHERE accountid=:v1");
+    auto& st = prep.statement();
+    st.exchange(into(account.balance));
+    st.exchange(into(inflationDest, inflationDestInd));
+    st.exchange(use(actIDStrKey));
+    st.define_and_bind();
+    {
+        auto timer = db.getSelectTimer("account");
+        st.execute(true);
+    }
+    if (!st.got_data() || inflationDestInd != soci::i_ok)
+    {
+        return false;
+    }
+    account.inflationDest.activate() =
+        KeyUtils::fromDbKey<PublicKey>(inflationDest);
+    return getInflationVote(account, vote);
+}
+
+void
+AccountFrame::updateInflationVotes(Database& db, bool hadVote,
+                                   InflationVotes const& oldVote,
+                                   bool hasVote, InflationVotes const& newVote)
+{
+    if (hadVote && hasVote && oldVote.mInflationDest == newVote.mInflationDest)
+    {
+        if (oldVote.mVotes != newVote.mVotes)
+        {
+            addInflationVotes(db, newVote.mInflationDest,
+                              newVote.mVotes - oldVote.mVotes);
+        }
+        return;
+    }
+    if (hadVote)
+    {
+        addInflationVotes(db, oldVote.mInflationDest, -oldVote.mVotes);
+    }
+    if (hasVote)
+    {
+        addInflationVotes(db, newVote.mInflationDest, newVote.mVotes);
+    }
+}
+
+void
+AccountFrame::addInflationVotes(Database& db, AccountID const& dest,
+                                int64 votes)
+{
+    std::string destStrKey = KeyUtils::toDbKey(dest);
+    {
+        auto timer = db.getUpdateTimer("inflationvotes");
+        auto prep = db.getPreparedStatement(
+            "UPDATE inflationvotes SET votes = votes + :v1 "
+            "WHERE inflationdest = :v2");
+        auto& st = prep.statement();
+        st.exchange(use(votes));
+        st.exchange(use(destStrKey));
+        st.define_and_bind();
+        st.execute(true);
+        if (st.get_affected_rows() == 1)
+        {
+            if (votes < 0)
+            {
+                // destinations without votes are not kept
+                auto del = db.getPreparedStatement(
+                    "DELETE FROM inflationvotes "
+                    "WHERE inflationdest = :v1 AND votes = 0");
+                auto& delSt = del.statement();
+                delSt.exchange(use(destStrKey));
+                delSt.define_and_bind();
+                delSt.execute(true);
+            }
+            return;
+        }
+    }
+
+    if (votes < 0)
+    {
+        throw std::runtime_error("Missing inflation votes for " +
+                                 KeyUtils::toStrKey(dest));
+    }
+    auto timer = db.getInsertTimer("inflationvotes");
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO inflationvotes (inflationdest, votes) VALUES (:v1, :v2)");
+    auto& st = prep.statement();
+    st.exchange(use(destStrKey));
+    st.exchange(use(votes));
+    st.define_and_bind();
+    st.execute(true);
+}
+
+void
+AccountFrame::rebuildInflationVotes(Database& db)
+{
+    db.getSession() << "DELETE FROM inflationvotes";
+    db.getSession() << "INSERT INTO inflationvotes (inflationdest, votes) "
+                       "SELECT inflationdest, sum(balance) FROM accounts "
+                       "WHERE inflationdest IS NOT NULL "
+                       "AND balance >= 1000000000 GROUP BY inflationdest";
+}
+
+void
+AccountFrame::createInflationVotes(Database& db)
+{
+    db.getSession() << "DROP TABLE IF EXISTS inflationvotes;";
+    db.getSession() << kSQLCreateStatement5;
+    db.getSession() << kSQLCreateStatement6;
+    rebuildInflationVotes(db);
 }
 
 std::unordered_map<AccountID, AccountFrame::pointer>
@@ -687,7 +1058,7 @@ AccountFrame::checkDB(Database& db)
         while (st.got_data())
         {
             state.insert(
-                std::make_pair(KeyUtils::fromStrKey<PublicKey>(id), nullptr));
+                std::make_pair(KeyUtils::fromDbKey<PublicKey>(id), nullptr));
             st.fetch();
         }
     }
@@ -708,7 +1079,7 @@ AccountFrame::checkDB(Database& db)
         st.execute(true);
         while (st.got_data())
         {
-            AccountID aid(KeyUtils::fromStrKey<PublicKey>(id));
+            AccountID aid(KeyUtils::fromDbKey<PublicKey>(id));
             auto it = state.find(aid);
             if (it == state.end())
             {
@@ -723,6 +1094,44 @@ AccountFrame::checkDB(Database& db)
             st.fetch();
         }
     }
+
+    {
+        // sanity check inflation votes
+        std::unordered_map<AccountID, int64> votes;
+        for (auto const& s : state)
+        {
+            InflationVotes v;
+            if (getInflationVote(s.second->mAccountEntry, v))
+            {
+                votes[v.mInflationDest] += v.mVotes;
+            }
+        }
+
+        std::string dest;
+        int64 n;
+        soci::statement st =
+            (db.getSession().prepare
+                 << "select inflationdest, votes from inflationvotes",
+             soci::into(dest), soci::into(n));
+        st.execute(true);
+        while (st.got_data())
+        {
+            auto it = votes.find(KeyUtils::fromDbKey<PublicKey>(dest));
+            if (it == votes.end() || it->second != n)
+            {
+                throw std::runtime_error(fmt::format(
+                    "Mismatch inflation votes for destination {}", dest));
+            }
+            votes.erase(it);
+            st.fetch();
+        }
+        if (!votes.empty())
+        {
+            throw std::runtime_error(
+                fmt::format("Missing inflation votes for destination {}",
+                            KeyUtils::toStrKey(votes.begin()->first)));
+        }
+    }
     return state;
 }
 
@@ -731,6 +1140,7 @@ AccountFrame::dropAll(Database& db)
 {
     db.getSession() << "DROP TABLE IF EXISTS accounts;";
     db.getSession() << "DROP TABLE IF EXISTS signers;";
+    db.getSession() << "DROP TABLE IF EXISTS inflationvotes;";
 
     db.getSession() << kSQLCreateStatement1;
     db.getSession() << kSQLCreateStatement2;
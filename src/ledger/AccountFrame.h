@@ -40,6 +40,19 @@ class AccountFrame : public EntryFrame
                                            std::string const& actIDStrKey);
     void applySigners(Database& db, bool insert);
 
+    // decodes the text columns of a row from the accounts table
+    static void loadAccountColumns(AccountEntry& account,
+                                   bool hasInflationDest,
+                                   std::string const& inflationDest,
+                                   std::string const& homeDomain,
+                                   std::string const& thresholds);
+    // loads up to kLoadAccountsBatchSize accounts and their signers
+    static void
+    loadAccountsBatch(std::vector<AccountID>::const_iterator begin,
+                      std::vector<AccountID>::const_iterator end,
+                      std::unordered_map<AccountID, AccountFrame::pointer>& res,
+                      Database& db);
+
   public:
     typedef std::shared_ptr<AccountFrame> pointer;
 
@@ -138,6 +151,12 @@ class AccountFrame : public EntryFrame
     static AccountFrame::pointer loadAccount(AccountID const& accountID,
                                              Database& db);
 
+    // loads several accounts with their signers using set based queries,
+    // missing accounts map to nullptr; all results are put in the entry cache
+    // so that subsequent calls to loadAccount do not hit the database
+    static std::unordered_map<AccountID, AccountFrame::pointer>
+    loadAccounts(std::vector<AccountID> const& accountIDs, Database& db);
+
     // compare signers, ignores weight
     static bool signerCompare(Signer const& s1, Signer const& s2);
 
@@ -158,12 +177,35 @@ class AccountFrame : public EntryFrame
     static std::unordered_map<AccountID, AccountFrame::pointer>
     checkDB(Database& db);
 
+    // creates the inflationvotes table from the content of accounts
+    static void createInflationVotes(Database& db);
+
     static void dropAll(Database& db);
 
   private:
+    // the inflationvotes table holds, for each destination, the sum of the
+    // balances of the accounts voting for it; it is kept up to date as
+    // accounts are stored
+    static bool getInflationVote(AccountEntry const& account,
+                                 InflationVotes& vote);
+    static bool loadInflationVote(LedgerKey const& key, Database& db,
+                                  InflationVotes& vote);
+    static void updateInflationVotes(Database& db, bool hadVote,
+                                     InflationVotes const& oldVote,
+                                     bool hasVote,
+                                     InflationVotes const& newVote);
+    static void addInflationVotes(Database& db, AccountID const& dest,
+                                  int64 votes);
+    static void rebuildInflationVotes(Database& db);
+
+    static const int64 kInflationVoteMinBalance;
+    static const size_t kLoadAccountsBatchSize;
+
     static const char* kSQLCreateStatement1;
     static const char* kSQLCreateStatement2;
     static const char* kSQLCreateStatement3;
     static const char* kSQLCreateStatement4;
+    static const char* kSQLCreateStatement5;
+    static const char* kSQLCreateStatement6;
 };
 }
@@ -79,7 +79,7 @@ DataFrame::loadData(AccountID const& accountID, std::string dataName,
 {
     DataFrame::pointer retData;
 
-    std::string actIDStrKey = KeyUtils::toStrKey(accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(accountID);
 
     std::string sql = dataColumnSelector;
     sql += " WHERE accountid = :id AND dataname = :dataname";
@@ -119,7 +119,7 @@ DataFrame::loadData(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        oe.accountID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        oe.accountID = KeyUtils::fromDbKey<PublicKey>(actIDStrKey);
 
         if ((dataNameIndicator != soci::i_ok) ||
             (dataValueIndicator != soci::i_ok))
@@ -153,7 +153,7 @@ DataFrame::loadAllData(Database& db)
 bool
 DataFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.data().accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(key.data().accountID);
     std::string dataName = key.data().dataName;
     int exists = 0;
     auto timer = db.getSelectTimer("data-exists");
@@ -216,7 +216,7 @@ DataFrame::storeDelete(LedgerDelta& delta, Database& db) const
 void
 DataFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.data().accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(key.data().accountID);
     std::string dataName = key.data().dataName;
     auto timer = db.getDeleteTimer("data");
     auto prep = db.getPreparedStatement(
@@ -246,7 +246,7 @@ DataFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mData.accountID);
+    std::string actIDStrKey = KeyUtils::toDbKey(mData.accountID);
     std::string dataName = mData.dataName;
     std::string dataValue = decoder::encode_b64(mData.dataValue);
 
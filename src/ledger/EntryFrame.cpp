@@ -10,6 +10,7 @@
 #include "ledger/DataFrame.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
 #include "ledger/TrustFrame.h"
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
@@ -110,6 +111,10 @@ EntryFrame::flushCachedEntry(LedgerKey const& key, Database& db)
 {
     auto s = binToHex(xdr::xdr_to_opaque(key));
     db.getEntryCache().erase_if_exists(s);
+    if (key.type() == OFFER)
+    {
+        db.getOrderBook().flushOffer(key.offer().offerID);
+    }
 }
 
 bool
@@ -3,6 +3,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerDelta.h"
+#include "database/Database.h"
+#include "ledger/OrderBook.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "medida/meter.h"
@@ -10,6 +12,7 @@
 #include "util/XDROperators.h"
 #include "xdr/Stellar-ledger.h"
 #include "xdrpp/printer.h"
+#include <algorithm>
 
 namespace stellar
 {
@@ -18,9 +21,16 @@ LedgerDelta::LedgerDelta(LedgerDelta& outerDelta)
     , mHeader(&outerDelta.getHeader())
     , mCurrentHeader(outerDelta.getHeader())
     , mPreviousHeaderValue(outerDelta.getHeader())
+    , mChangeSet(outerDelta.mChangeSet)
+    , mDepth(outerDelta.mDepth + 1)
+    , mLevel(++outerDelta.mChangeSet.mLastLevel)
+    , mSavepoint(outerDelta.mChangeSet.mUndoLog.size())
+    , mLogEnd(0)
     , mDb(outerDelta.mDb)
     , mUpdateLastModified(outerDelta.mUpdateLastModified)
 {
+    outerDelta.checkState();
+    mChangeSet.mDepth = mDepth;
 }
 
 LedgerDelta::LedgerDelta(LedgerHeader& header, Database& db,
@@ -29,9 +39,16 @@ LedgerDelta::LedgerDelta(LedgerHeader& header, Database& db,
     , mHeader(&header)
     , mCurrentHeader(header)
     , mPreviousHeaderValue(header)
+    , mOwnedChangeSet(std::make_unique<ChangeSet>())
+    , mChangeSet(*mOwnedChangeSet)
+    , mDepth(1)
+    , mLevel(++mOwnedChangeSet->mLastLevel)
+    , mSavepoint(0)
+    , mLogEnd(0)
     , mDb(db)
     , mUpdateLastModified(updateLastModified)
 {
+    mChangeSet.mDepth = mDepth;
 }
 
 LedgerDelta::~LedgerDelta()
@@ -74,6 +91,11 @@ LedgerDelta::checkState()
         throw std::runtime_error(
             "Invalid operation: delta is already committed");
     }
+    if (mChangeSet.mDepth != mDepth)
+    {
+        throw std::runtime_error(
+            "Invalid operation: delta has an active nested delta");
+    }
 }
 
 void
@@ -100,24 +122,41 @@ LedgerDelta::recordEntry(EntryFrame const& entry)
     recordEntry(entry.copy());
 }
 
+LedgerDelta::Change&
+LedgerDelta::saveChange(LedgerKey const& key)
+{
+    checkState();
+    auto it = mChangeSet.mChanges.find(key);
+    if (it == mChangeSet.mChanges.end())
+    {
+        it = mChangeSet.mChanges.emplace(key, Change{}).first;
+    }
+    // the top level delta never rolls back individual changes, so only
+    // nested deltas need to remember what they overwrite
+    if (mDepth > 1 && it->second.mLevel != mLevel)
+    {
+        mChangeSet.mUndoLog.emplace_back(UndoRecord{it, it->second});
+        it->second.mLevel = mLevel;
+    }
+    return it->second;
+}
+
 void
 LedgerDelta::addEntry(EntryFrame::pointer entry)
 {
-    checkState();
-    auto k = entry->getKey();
-    auto del_it = mDelete.find(k);
-    if (del_it != mDelete.end())
+    auto& c = saveChange(entry->getKey());
+    if (c.mState == EntryState::kDelete)
     {
         // delete + new is an update
-        mDelete.erase(del_it);
-        mMod[k] = entry;
+        c.mState = EntryState::kMod;
     }
     else
     {
-        assert(mNew.find(k) == mNew.end()); // double new
-        assert(mMod.find(k) == mMod.end()); // mod + new is invalid
-        mNew[k] = entry;
+        // double new or mod + new is invalid
+        assert(c.mState == EntryState::kNone);
+        c.mState = EntryState::kNew;
     }
+    c.mCurrent = entry;
 }
 
 void
@@ -130,50 +169,35 @@ LedgerDelta::deleteEntry(EntryFrame::pointer entry)
 void
 LedgerDelta::deleteEntry(LedgerKey const& k)
 {
-    checkState();
-    auto new_it = mNew.find(k);
-    if (new_it != mNew.end())
+    auto& c = saveChange(k);
+    if (c.mState == EntryState::kNew)
     {
         // new + delete -> don't add it in the first place
-        mNew.erase(new_it);
+        c.mState = EntryState::kNone;
     }
     else
     {
         // double delete here means there is buggy code upstream
         // and we cannot keep going as this may corrupt the bucket list
-        assert(mDelete.find(k) == mDelete.end());
+        assert(c.mState != EntryState::kDelete);
 
         // mod + delete -> delete
-        mMod.erase(k);
-        mDelete.insert(k);
+        c.mState = EntryState::kDelete;
     }
+    c.mCurrent.reset();
 }
 
 void
 LedgerDelta::modEntry(EntryFrame::pointer entry)
 {
-    checkState();
-    auto k = entry->getKey();
-    auto mod_it = mMod.find(k);
-    if (mod_it != mMod.end())
+    auto& c = saveChange(entry->getKey());
+    // collapse mod, new + mod = new (with latest value)
+    assert(c.mState != EntryState::kDelete); // delete + mod is illegal
+    if (c.mState == EntryState::kNone)
     {
-        // collapse mod
-        mod_it->second = entry;
-    }
-    else
-    {
-        auto new_it = mNew.find(k);
-        if (new_it != mNew.end())
-        {
-            // new + mod = new (with latest value)
-            new_it->second = entry;
-        }
-        else
-        {
-            assert(mDelete.find(k) == mDelete.end()); // delete + mod is illegal
-            mMod[k] = entry;
-        }
+        c.mState = EntryState::kMod;
     }
+    c.mCurrent = entry;
 }
 
 void
@@ -181,37 +205,94 @@ LedgerDelta::recordEntry(EntryFrame::pointer entry)
 {
     checkState();
     // keeps the old one around
-    mPrevious.insert(std::make_pair(entry->getKey(), entry));
+    auto it = mChangeSet.mChanges.find(entry->getKey());
+    if (it == mChangeSet.mChanges.end() || !it->second.mPrevious)
+    {
+        saveChange(entry->getKey()).mPrevious = entry;
+    }
 }
 
-void
-LedgerDelta::mergeEntries(LedgerDelta& other)
+LedgerDelta::LevelChanges
+LedgerDelta::getLevelChanges(EntryState state) const
 {
-    checkState();
+    LevelChanges res;
+    auto keep = [&](EntryState s) {
+        return s != EntryState::kNone &&
+               (state == EntryState::kNone || state == s);
+    };
 
-    // propagates mPrevious for deleted & modified entries
-    for (auto& d : other.mDelete)
+    if (mDepth == 1)
     {
-        deleteEntry(d);
-        auto it = other.mPrevious.find(d);
-        if (it != other.mPrevious.end())
+        for (auto const& c : mChangeSet.mChanges)
         {
-            recordEntry(*it->second);
+            if (keep(c.second.mState))
+            {
+                res.emplace_back(LevelChange{&c.first, c.second.mState,
+                                             c.second.mCurrent,
+                                             c.second.mPrevious});
+            }
         }
+        return res;
     }
-    for (auto& n : other.mNew)
+
+    // the first undo record of a key in this delta's range holds the value
+    // the key had when this delta started
+    auto const& log = mChangeSet.mUndoLog;
+    auto end = std::min(mHeader ? log.size() : mLogEnd, log.size());
+    std::vector<UndoRecord const*> records;
+    records.reserve(end > mSavepoint ? end - mSavepoint : 0);
+    for (auto i = mSavepoint; i < end; i++)
     {
-        addEntry(n.second);
+        records.emplace_back(&log[i]);
     }
-    for (auto& m : other.mMod)
+    LedgerEntryIdCmp cmp;
+    std::stable_sort(records.begin(), records.end(),
+                     [&](UndoRecord const* l, UndoRecord const* r) {
+                         return cmp(l->mChange->first, r->mChange->first);
+                     });
+    records.erase(std::unique(records.begin(), records.end(),
+                              [](UndoRecord const* l, UndoRecord const* r) {
+                                  return l->mChange == r->mChange;
+                              }),
+                  records.end());
+
+    for (auto r : records)
     {
-        modEntry(m.second);
-        auto it = other.mPrevious.find(m.first);
-        if (it != other.mPrevious.end())
+        auto const& before = r->mBefore;
+        auto const& after = r->mChange->second;
+        if (before.mState == after.mState && before.mCurrent == after.mCurrent)
+        {
+            continue;
+        }
+        EntryState s = EntryState::kNone;
+        EntryFrame::pointer previous;
+        switch (before.mState)
+        {
+        case EntryState::kNone:
+            s = after.mState;
+            previous = after.mPrevious;
+            break;
+        case EntryState::kNew:
+            s = after.mState == EntryState::kNone ? EntryState::kDelete
+                                                  : EntryState::kMod;
+            previous = before.mCurrent;
+            break;
+        case EntryState::kMod:
+            s = after.mState;
+            previous = before.mCurrent;
+            break;
+        case EntryState::kDelete:
+            s = after.mState == EntryState::kMod ? EntryState::kNew
+                                                 : EntryState::kNone;
+            break;
+        }
+        if (keep(s))
         {
-            recordEntry(*it->second);
+            res.emplace_back(LevelChange{&r->mChange->first, s,
+                                         after.mCurrent, previous});
         }
     }
+    return res;
 }
 
 void
@@ -225,11 +306,11 @@ LedgerDelta::commit()
         throw std::runtime_error("unexpected header state");
     }
 
-    if (mOuterDelta)
-    {
-        mOuterDelta->mergeEntries(*this);
-        mOuterDelta = nullptr;
-    }
+    // entries are already in the shared change set: the undo records of this
+    // delta now belong to the outer delta
+    mLogEnd = mChangeSet.mUndoLog.size();
+    mChangeSet.mDepth--;
+    mOuterDelta = nullptr;
     *mHeader = mCurrentHeader.mHeader;
     mHeader = nullptr;
 }
@@ -239,56 +320,113 @@ LedgerDelta::rollback()
 {
     checkState();
     mHeader = nullptr;
+    mChangeSet.mDepth--;
 
-    for (auto& d : mDelete)
-    {
-        EntryFrame::flushCachedEntry(d, mDb);
-    }
-    for (auto& n : mNew)
+    if (mDepth == 1)
     {
-        EntryFrame::flushCachedEntry(n.first, mDb);
+        for (auto const& c : mChangeSet.mChanges)
+        {
+            if (c.second.mState != EntryState::kNone)
+            {
+                flushChange(c.first, c.second, Change{});
+            }
+        }
+        return;
     }
-    for (auto& m : mMod)
+
+    auto& log = mChangeSet.mUndoLog;
+    while (log.size() > mSavepoint)
     {
-        EntryFrame::flushCachedEntry(m.first, mDb);
+        auto& r = log.back();
+        auto undone = r.mChange->second;
+        r.mChange->second = r.mBefore;
+        flushChange(r.mChange->first, undone, r.mBefore);
+        log.pop_back();
     }
+    mLogEnd = mSavepoint;
 }
 
 void
-LedgerDelta::addCurrentMeta(LedgerEntryChanges& changes,
-                            LedgerKey const& key) const
+LedgerDelta::flushChange(LedgerKey const& key, Change const& undone,
+                         Change const& restored)
 {
-    auto it = mPrevious.find(key);
-    if (it != mPrevious.end())
+    EntryFrame::flushCachedEntry(key, mDb);
+    if (key.type() != OFFER)
+    {
+        return;
+    }
+
+    // the offer is back in the book of the value restored in the database,
+    // which may have been loaded without it
+    EntryFrame::pointer value;
+    switch (restored.mState)
     {
-        auto const& e = it->second->mEntry;
-        changes.emplace_back(LEDGER_ENTRY_STATE);
-        changes.back().state() = e;
+    case EntryState::kNew:
+    case EntryState::kMod:
+        value = restored.mCurrent;
+        break;
+    case EntryState::kDelete:
+        return;
+    case EntryState::kNone:
+        if (undone.mState == EntryState::kNew)
+        {
+            // did not exist before the top level delta
+            return;
+        }
+        value = undone.mPrevious;
+        break;
     }
+
+    auto& books = mDb.getOrderBook();
+    if (!value)
+    {
+        // the value the offer had was not recorded, its book is unknown
+        books.clear();
+        return;
+    }
+    auto const& offer = value->mEntry.data.offer();
+    books.flushBook(offer.selling, offer.buying);
 }
 
 LedgerEntryChanges
 LedgerDelta::getChanges() const
 {
     LedgerEntryChanges changes;
+    auto levelChanges = getLevelChanges();
 
-    for (auto const& k : mNew)
+    for (auto const& c : levelChanges)
     {
-        changes.emplace_back(LEDGER_ENTRY_CREATED);
-        changes.back().created() = k.second->mEntry;
+        if (c.mState == EntryState::kNew)
+        {
+            changes.emplace_back(LEDGER_ENTRY_CREATED);
+            changes.back().created() = c.mCurrent->mEntry;
+        }
     }
-    for (auto const& k : mMod)
+    for (auto const& c : levelChanges)
     {
-        addCurrentMeta(changes, k.first);
-        changes.emplace_back(LEDGER_ENTRY_UPDATED);
-        changes.back().updated() = k.second->mEntry;
+        if (c.mState == EntryState::kMod)
+        {
+            if (c.mPrevious)
+            {
+                changes.emplace_back(LEDGER_ENTRY_STATE);
+                changes.back().state() = c.mPrevious->mEntry;
+            }
+            changes.emplace_back(LEDGER_ENTRY_UPDATED);
+            changes.back().updated() = c.mCurrent->mEntry;
+        }
     }
-
-    for (auto const& k : mDelete)
+    for (auto const& c : levelChanges)
     {
-        addCurrentMeta(changes, k);
-        changes.emplace_back(LEDGER_ENTRY_REMOVED);
-        changes.back().removed() = k;
+        if (c.mState == EntryState::kDelete)
+        {
+            if (c.mPrevious)
+            {
+                changes.emplace_back(LEDGER_ENTRY_STATE);
+                changes.back().state() = c.mPrevious->mEntry;
+            }
+            changes.emplace_back(LEDGER_ENTRY_REMOVED);
+            changes.back().removed() = *c.mKey;
+        }
     }
 
     return changes;
@@ -298,16 +436,23 @@ std::vector<LedgerEntry>
 LedgerDelta::getLiveEntries() const
 {
     std::vector<LedgerEntry> live;
+    auto levelChanges = getLevelChanges();
 
-    live.reserve(mNew.size() + mMod.size());
+    live.reserve(levelChanges.size());
 
-    for (auto const& k : mNew)
+    for (auto const& c : levelChanges)
     {
-        live.push_back(k.second->mEntry);
+        if (c.mState == EntryState::kNew)
+        {
+            live.push_back(c.mCurrent->mEntry);
+        }
     }
-    for (auto const& k : mMod)
+    for (auto const& c : levelChanges)
     {
-        live.push_back(k.second->mEntry);
+        if (c.mState == EntryState::kMod)
+        {
+            live.push_back(c.mCurrent->mEntry);
+        }
     }
 
     return live;
@@ -318,11 +463,9 @@ LedgerDelta::getDeadEntries() const
 {
     std::vector<LedgerKey> dead;
 
-    dead.reserve(mDelete.size());
-
-    for (auto const& k : mDelete)
+    for (auto const& c : getLevelChanges(EntryState::kDelete))
     {
-        dead.push_back(k);
+        dead.push_back(*c.mKey);
     }
     return dead;
 }
@@ -336,9 +479,9 @@ LedgerDelta::updateLastModified() const
 void
 LedgerDelta::markMeters(Application& app) const
 {
-    for (auto const& ke : mNew)
+    for (auto const& ke : getLevelChanges(EntryState::kNew))
     {
-        switch (ke.first.type())
+        switch (ke.mKey->type())
         {
         case ACCOUNT:
             app.getMetrics()
@@ -363,9 +506,9 @@ LedgerDelta::markMeters(Application& app) const
         }
     }
 
-    for (auto const& ke : mMod)
+    for (auto const& ke : getLevelChanges(EntryState::kMod))
     {
-        switch (ke.first.type())
+        switch (ke.mKey->type())
         {
         case ACCOUNT:
             app.getMetrics()
@@ -390,9 +533,9 @@ LedgerDelta::markMeters(Application& app) const
         }
     }
 
-    for (auto const& ke : mDelete)
+    for (auto const& ke : getLevelChanges(EntryState::kDelete))
     {
-        switch (ke.type())
+        switch (ke.mKey->type())
         {
         case ACCOUNT:
             app.getMetrics()
@@ -418,60 +561,62 @@ LedgerDelta::markMeters(Application& app) const
     }
 }
 
-template <typename IterType, typename ValueType>
+template <typename ValueType>
 void
-LedgerDelta::Iterator<IterType, ValueType>::createValueIfNecessary() const
+LedgerDelta::Iterator<ValueType>::createValueIfNecessary() const
 {
     if (!mValue)
     {
-        mValue = std::make_shared<ValueType>(mDelta, *mIter);
+        mValue = std::make_shared<ValueType>(mChanges->at(mIndex));
     }
 }
 
-template <typename IterType, typename ValueType>
-LedgerDelta::Iterator<IterType, ValueType>::Iterator(LedgerDelta const& delta,
-                                                     IterType const& iter)
-    : mDelta(delta), mIter(iter)
+template <typename ValueType>
+LedgerDelta::Iterator<ValueType>::Iterator(
+    std::shared_ptr<LevelChanges const> changes, size_t index)
+    : mChanges(changes), mIndex(index)
 {
 }
 
-template <typename IterType, typename ValueType>
-ValueType const& LedgerDelta::Iterator<IterType, ValueType>::operator*() const
+template <typename ValueType>
+ValueType const& LedgerDelta::Iterator<ValueType>::operator*() const
 {
     createValueIfNecessary();
     return *mValue;
 }
 
-template <typename IterType, typename ValueType>
-ValueType const* LedgerDelta::Iterator<IterType, ValueType>::operator->() const
+template <typename ValueType>
+ValueType const* LedgerDelta::Iterator<ValueType>::operator->() const
 {
     createValueIfNecessary();
     return mValue.get();
 }
 
-template <typename IterType, typename ValueType>
-LedgerDelta::Iterator<IterType, ValueType>&
-    LedgerDelta::Iterator<IterType, ValueType>::operator++()
+template <typename ValueType>
+LedgerDelta::Iterator<ValueType>& LedgerDelta::Iterator<ValueType>::
+operator++()
 {
-    ++mIter;
+    ++mIndex;
     mValue.reset();
     return *this;
 }
 
-template <typename IterType, typename ValueType>
+// iterators only compare positions so that ranges obtained from different
+// calls to added(), modified() or deleted() can be mixed
+template <typename ValueType>
 bool
-LedgerDelta::Iterator<IterType, ValueType>::
-operator==(Iterator<IterType, ValueType> const& other) const
+LedgerDelta::Iterator<ValueType>::
+operator==(Iterator<ValueType> const& other) const
 {
-    return mIter == other.mIter;
+    return mIndex == other.mIndex;
 }
 
-template <typename IterType, typename ValueType>
+template <typename ValueType>
 bool
-LedgerDelta::Iterator<IterType, ValueType>::
-operator!=(Iterator<IterType, ValueType> const& other) const
+LedgerDelta::Iterator<ValueType>::
+operator!=(Iterator<ValueType> const& other) const
 {
-    return !(mIter == other.mIter);
+    return !(mIndex == other.mIndex);
 }
 
 template <typename IterType>
@@ -495,57 +640,64 @@ LedgerDelta::IteratorRange<IterType>::end() const
     return mEnd;
 }
 
-template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
-                                     LedgerDelta::AddedLedgerEntry>;
+template <typename ValueType>
+LedgerDelta::IteratorRange<LedgerDelta::Iterator<ValueType>>
+LedgerDelta::makeRange(EntryState state) const
+{
+    auto changes = std::make_shared<LevelChanges const>(getLevelChanges(state));
+    auto size = changes->size();
+    return {Iterator<ValueType>(changes, 0),
+            Iterator<ValueType>(changes, size)};
+}
+
+template class LedgerDelta::Iterator<LedgerDelta::AddedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>;
 
-LedgerDelta::AddedLedgerEntry::AddedLedgerEntry(
-    LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
-    : key(pair.first), current(pair.second)
+LedgerDelta::AddedLedgerEntry::AddedLedgerEntry(LevelChange const& change)
+    : key(*change.mKey), current(change.mCurrent)
 {
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>
 LedgerDelta::added() const
 {
-    return {LedgerDelta::AddedIterator(*this, mNew.cbegin()),
-            LedgerDelta::AddedIterator(*this, mNew.cend())};
+    return makeRange<AddedLedgerEntry>(EntryState::kNew);
 }
 
-template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
-                                     LedgerDelta::ModifiedLedgerEntry>;
+template class LedgerDelta::Iterator<LedgerDelta::ModifiedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>;
 
 LedgerDelta::ModifiedLedgerEntry::ModifiedLedgerEntry(
-    LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
-    : key(pair.first)
-    , current(pair.second)
-    , previous(delta.mPrevious.at(pair.first))
+    LevelChange const& change)
+    : key(*change.mKey), current(change.mCurrent), previous(change.mPrevious)
 {
+    if (!previous)
+    {
+        throw std::out_of_range("modified entry has no previous value");
+    }
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>
 LedgerDelta::modified() const
 {
-    return {LedgerDelta::ModifiedIterator(*this, mMod.cbegin()),
-            LedgerDelta::ModifiedIterator(*this, mMod.cend())};
+    return makeRange<ModifiedLedgerEntry>(EntryState::kMod);
 }
 
-template class LedgerDelta::Iterator<
-    std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-    LedgerDelta::DeletedLedgerEntry>;
+template class LedgerDelta::Iterator<LedgerDelta::DeletedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>;
 
-LedgerDelta::DeletedLedgerEntry::DeletedLedgerEntry(LedgerDelta const& delta,
-                                                    LedgerKey const& value)
-    : key(value), previous(delta.mPrevious.at(value))
+LedgerDelta::DeletedLedgerEntry::DeletedLedgerEntry(LevelChange const& change)
+    : key(*change.mKey), previous(change.mPrevious)
 {
+    if (!previous)
+    {
+        throw std::out_of_range("deleted entry has no previous value");
+    }
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>
 LedgerDelta::deleted() const
 {
-    return {LedgerDelta::DeletedIterator(*this, mDelete.cbegin()),
-            LedgerDelta::DeletedIterator(*this, mDelete.cend())};
+    return makeRange<DeletedLedgerEntry>(EntryState::kDelete);
 }
 }
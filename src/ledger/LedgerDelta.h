@@ -12,6 +12,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 namespace stellar
 {
@@ -20,8 +21,53 @@ class Database;
 
 class LedgerDelta
 {
-    typedef std::map<LedgerKey, EntryFrame::pointer, LedgerEntryIdCmp>
-        KeyEntryMap;
+    // state of an entry relative to the start of the top level delta
+    enum class EntryState
+    {
+        kNone,
+        kNew,
+        kMod,
+        kDelete
+    };
+
+    struct Change
+    {
+        EntryState mState{EntryState::kNone};
+        // latest value of the entry (set for kNew and kMod)
+        EntryFrame::pointer mCurrent;
+        // first value recorded with recordEntry
+        EntryFrame::pointer mPrevious;
+        // id of the last nested delta that saved this change in the undo log
+        uint64_t mLevel{0};
+    };
+    typedef std::map<LedgerKey, Change, LedgerEntryIdCmp> ChangeMap;
+
+    // value of a change before a nested delta first modified it
+    struct UndoRecord
+    {
+        ChangeMap::iterator mChange;
+        Change mBefore;
+    };
+
+    // flat set of changes shared by a top level delta and all the deltas
+    // nested in it; nested deltas are savepoints in the undo log
+    struct ChangeSet
+    {
+        ChangeMap mChanges;
+        std::vector<UndoRecord> mUndoLog;
+        size_t mDepth{0};
+        uint64_t mLastLevel{0};
+    };
+
+    // change as seen from a single delta
+    struct LevelChange
+    {
+        LedgerKey const* mKey;
+        EntryState mState;
+        EntryFrame::pointer mCurrent;
+        EntryFrame::pointer mPrevious;
+    };
+    typedef std::vector<LevelChange> LevelChanges;
 
     LedgerDelta*
         mOuterDelta;       // set when this delta is nested inside another delta
@@ -31,11 +77,15 @@ class LedgerDelta
     // ledger header itself
     LedgerHeaderFrame mCurrentHeader;
     LedgerHeader mPreviousHeaderValue;
-    // ledger entries
-    KeyEntryMap mNew;
-    KeyEntryMap mMod;
-    std::set<LedgerKey, LedgerEntryIdCmp> mDelete;
-    KeyEntryMap mPrevious;
+    // ledger entries, owned by the top level delta
+    std::unique_ptr<ChangeSet> mOwnedChangeSet;
+    ChangeSet& mChangeSet;
+    // position of this delta in the stack of nested deltas (1 for top level)
+    size_t const mDepth;
+    uint64_t const mLevel;
+    // range of the undo log that belongs to this delta
+    size_t const mSavepoint;
+    size_t mLogEnd;
 
     Database& mDb; // Used strictly for rollback of db entry cache.
 
@@ -47,13 +97,18 @@ class LedgerDelta
     void modEntry(EntryFrame::pointer entry);
     void recordEntry(EntryFrame::pointer entry);
 
-    // merge "other" into current ledgerDelta
-    void mergeEntries(LedgerDelta& other);
+    // returns the change for key, saving its current value in the undo log
+    // the first time this delta touches it
+    Change& saveChange(LedgerKey const& key);
 
-    // helper method that adds a meta entry to "changes"
-    // with the previous value of an entry if needed
-    void addCurrentMeta(LedgerEntryChanges& changes,
-                        LedgerKey const& key) const;
+    // flushes the db caches of an entry whose change `undone` is rolled back
+    // to `restored`
+    void flushChange(LedgerKey const& key, Change const& undone,
+                     Change const& restored);
+
+    // changes made by this delta (including committed nested deltas), sorted
+    // by key; if state is not kNone, only returns changes in that state
+    LevelChanges getLevelChanges(EntryState state = EntryState::kNone) const;
 
   public:
     // keeps an internal reference to the outerDelta,
@@ -83,6 +138,8 @@ class LedgerDelta
     void recordEntry(EntryFrame const& entry);
 
     // commits this delta into outer delta
+    // only the innermost active delta can be modified, committed or rolled
+    // back
     void commit();
     // aborts any changes pending, flush db cache entries
     void rollback();
@@ -97,23 +154,23 @@ class LedgerDelta
 
     LedgerEntryChanges getChanges() const;
 
-    template <typename IterType, typename ValueType>
+    template <typename ValueType>
     class Iterator : public std::iterator<std::input_iterator_tag, ValueType>
     {
-        LedgerDelta const& mDelta;
-        IterType mIter;
+        std::shared_ptr<LevelChanges const> mChanges;
+        size_t mIndex;
 
         mutable std::shared_ptr<ValueType> mValue;
 
         void createValueIfNecessary() const;
 
       public:
-        Iterator(LedgerDelta const& delta, IterType const& iter);
+        Iterator(std::shared_ptr<LevelChanges const> changes, size_t index);
 
         ValueType const& operator*() const;
         ValueType const* operator->() const;
 
-        Iterator<IterType, ValueType>& operator++();
+        Iterator<ValueType>& operator++();
 
         bool operator==(Iterator const& other) const;
         bool operator!=(Iterator const& other) const;
@@ -136,11 +193,9 @@ class LedgerDelta
         LedgerKey key;
         EntryFrame::pointer current;
 
-        explicit AddedLedgerEntry(LedgerDelta const& delta,
-                                  KeyEntryMap::value_type const& pair);
+        explicit AddedLedgerEntry(LevelChange const& change);
     };
-    typedef Iterator<KeyEntryMap::const_iterator, AddedLedgerEntry>
-        AddedIterator;
+    typedef Iterator<AddedLedgerEntry> AddedIterator;
     IteratorRange<AddedIterator> added() const;
 
     struct ModifiedLedgerEntry
@@ -149,11 +204,9 @@ class LedgerDelta
         EntryFrame::pointer current;
         EntryFrame::pointer previous;
 
-        explicit ModifiedLedgerEntry(LedgerDelta const& delta,
-                                     KeyEntryMap::value_type const& pair);
+        explicit ModifiedLedgerEntry(LevelChange const& change);
     };
-    typedef Iterator<KeyEntryMap::const_iterator, ModifiedLedgerEntry>
-        ModifiedIterator;
+    typedef Iterator<ModifiedLedgerEntry> ModifiedIterator;
     IteratorRange<ModifiedIterator> modified() const;
 
     struct DeletedLedgerEntry
@@ -161,12 +214,13 @@ class LedgerDelta
         LedgerKey key;
         EntryFrame::pointer previous;
 
-        explicit DeletedLedgerEntry(LedgerDelta const& delta,
-                                    LedgerKey const& value);
+        explicit DeletedLedgerEntry(LevelChange const& change);
     };
-    typedef Iterator<std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-                     DeletedLedgerEntry>
-        DeletedIterator;
+    typedef Iterator<DeletedLedgerEntry> DeletedIterator;
     IteratorRange<DeletedIterator> deleted() const;
+
+  private:
+    template <typename ValueType>
+    IteratorRange<Iterator<ValueType>> makeRange(EntryState state) const;
 };
 }
@@ -4,9 +4,12 @@
 
 #include "util/asio.h"
 #include "LedgerTestUtils.h"
+#include "database/Database.h"
 #include "ledger/AccountFrame.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "test/TestUtils.h"
@@ -76,6 +79,17 @@ TEST_CASE("Ledger delta", "[ledger][ledgerdelta]")
         }
     }
 
+    SECTION("only the innermost delta can be used")
+    {
+        LedgerDelta delta2(delta);
+        REQUIRE_THROWS_AS(LedgerDelta{delta}, std::runtime_error);
+        REQUIRE_THROWS_AS(delta.commit(), std::runtime_error);
+        delta2.getHeader().idPool++;
+        delta2.commit();
+        delta.commit();
+        REQUIRE(curHeader.idPool == orgHeader.idPool + 1);
+    }
+
     SECTION("delta object operations")
     {
         size_t const nbAccounts = 36;
@@ -332,3 +346,94 @@ TEST_CASE("Ledger delta", "[ledger][ledgerdelta]")
         }
     }
 }
+
+TEST_CASE("Ledger delta rollback and order books", "[ledger][ledgerdelta]")
+{
+    Config cfg(getTestConfig());
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+    LedgerHeader& curHeader = app->getLedgerManager().getCurrentLedgerHeader();
+    Database& db = app->getDatabase();
+    auto& books = db.getOrderBook();
+
+    auto offer = LedgerTestUtils::generateValidOfferEntry();
+    auto selling = offer.selling;
+    auto buying = offer.buying;
+    {
+        LedgerDelta setup(curHeader, db);
+        LedgerEntry le;
+        le.data.type(OFFER);
+        le.data.offer() = offer;
+        OfferFrame(le).storeAdd(setup, db);
+        setup.commit();
+    }
+
+    // the book of both pairs the offer is moved between matches the database
+    auto checkBooks = [&]() {
+        for (auto const& p : {std::make_pair(selling, buying),
+                              std::make_pair(buying, selling)})
+        {
+            std::vector<LedgerEntry> fromDb;
+            OfferFrame::loadOrderBook(
+                p.first, p.second, db,
+                [&](LedgerEntry const& of) { fromDb.emplace_back(of); });
+            std::vector<LedgerEntry> inMemory;
+            for (auto const& of : books.getOffers(p.first, p.second, db))
+            {
+                inMemory.emplace_back(of.second);
+            }
+            REQUIRE(inMemory == fromDb);
+        }
+    };
+
+    LedgerDelta delta(curHeader, db);
+
+    SECTION("deleted offer")
+    {
+        LedgerDelta delta2(delta);
+        auto of = OfferFrame::loadOffer(offer.sellerID, offer.offerID, db,
+                                        &delta2);
+        of->storeDelete(delta2, db);
+        // loaded without the offer
+        checkBooks();
+        delta2.rollback();
+        checkBooks();
+        REQUIRE(books.getOffers(selling, buying, db).size() == 1);
+    }
+
+    SECTION("offer moved to another pair")
+    {
+        LedgerDelta delta2(delta);
+        auto of = OfferFrame::loadOffer(offer.sellerID, offer.offerID, db,
+                                        &delta2);
+        std::swap(of->getOffer().selling, of->getOffer().buying);
+        of->storeChange(delta2, db);
+        checkBooks();
+        delta2.rollback();
+        checkBooks();
+        REQUIRE(books.getOffers(selling, buying, db).size() == 1);
+        REQUIRE(books.getOffers(buying, selling, db).empty());
+    }
+
+    SECTION("top level rollback")
+    {
+        auto of =
+            OfferFrame::loadOffer(offer.sellerID, offer.offerID, db, &delta);
+        of->storeDelete(delta, db);
+        checkBooks();
+        delta.rollback();
+        checkBooks();
+        REQUIRE(books.getOffers(selling, buying, db).size() == 1);
+    }
+
+    SECTION("change without a recorded value")
+    {
+        LedgerDelta delta2(delta);
+        auto of = OfferFrame::loadOffer(offer.sellerID, offer.offerID, db);
+        of->storeDelete(delta2, db);
+        checkBooks();
+        delta2.rollback();
+        checkBooks();
+    }
+}
@@ -8,6 +8,7 @@
 #include "TrustFrame.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/OrderBook.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
@@ -80,6 +81,27 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         }
         app->getLedgerManager().checkDbState();
 
+        // batched load matches the database state
+        {
+            std::vector<AccountID> ids;
+            for (auto const& l : accountsMap)
+            {
+                ids.emplace_back(l.first);
+            }
+            auto missing = LedgerTestUtils::generateValidAccountEntry(5);
+            ids.emplace_back(missing.accountID);
+
+            db.getEntryCache().clear();
+            auto fromDb = AccountFrame::loadAccounts(ids, db);
+            REQUIRE(fromDb.size() == ids.size());
+            for (auto const& l : accountsMap)
+            {
+                AccountFrame af(l.second);
+                REQUIRE(af.getAccount() == fromDb.at(l.first)->getAccount());
+            }
+            REQUIRE(!fromDb.at(missing.accountID));
+        }
+
         // create a bunch of trust lines
         std::unordered_map<AccountID, std::vector<TrustFrame::pointer>>
             trustLinesMap;
@@ -162,6 +184,30 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
             offerMap;
         std::unordered_set<uint64> offerIDs;
 
+        // asset pairs of all the offers seen so far, with their order book
+        // kept in memory
+        std::vector<std::pair<Asset, Asset>> offerPairs;
+        auto checkOrderBooks = [&]() {
+            for (auto const& p : offerPairs)
+            {
+                std::vector<LedgerEntry> fromDb;
+                OfferFrame::loadOrderBook(
+                    p.first, p.second, db,
+                    [&](LedgerEntry const& of) { fromDb.emplace_back(of); });
+                std::vector<LedgerEntry> inMemory;
+                for (auto const& of :
+                     db.getOrderBook().getOffers(p.first, p.second, db))
+                {
+                    inMemory.emplace_back(of.second);
+                }
+                REQUIRE(inMemory == fromDb);
+            }
+        };
+        auto trackOrderBook = [&](OfferEntry const& of) {
+            offerPairs.emplace_back(of.selling, of.buying);
+            db.getOrderBook().getOffers(of.selling, of.buying, db);
+        };
+
         auto offerProcessor = [&](std::function<int(LedgerEntry&)> proc) {
             entriesProcessor([&](LedgerEntry& account) {
                 AccountEntry& newA = account.data.account();
@@ -188,6 +234,7 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
                           le.data.offer().offerID) == offerIDs.end())
             {
                 auto off = std::make_shared<OfferFrame>(le);
+                trackOrderBook(off->getOffer());
                 off->storeAdd(delta, db);
                 offers.emplace_back(off);
                 offerIDs.insert(off->getOfferID());
@@ -197,6 +244,7 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         });
 
         app->getLedgerManager().checkDbState();
+        checkOrderBooks();
 
         // modify offers
         offerProcessor([&](LedgerEntry& le) {
@@ -216,6 +264,7 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
 
                 thisO = newO;
 
+                trackOrderBook(thisO);
                 off->storeChange(delta, db);
                 auto fromDb =
                     OfferFrame::loadOffer(thisO.sellerID, thisO.offerID, db);
@@ -225,6 +274,7 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         });
 
         app->getLedgerManager().checkDbState();
+        checkOrderBooks();
 
         // delete offers
         for (auto& ofl : offerMap)
@@ -242,6 +292,7 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         }
 
         app->getLedgerManager().checkDbState();
+        checkOrderBooks();
 
         // delete trust lines
         for (auto& atl : trustLinesMap)
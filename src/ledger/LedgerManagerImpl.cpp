@@ -1002,6 +1002,7 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
     try
     {
         soci::transaction sqlTx(mApp.getDatabase().getSession());
+        TransactionFrame::prefetchAccounts(txs, mApp.getDatabase());
         for (auto tx : txs)
         {
             LedgerDelta thisTxDelta(delta);
@@ -1035,6 +1036,12 @@ LedgerManagerImpl::applyTransactions(std::vector<TransactionFramePtr>& txs,
         mTransactionCount.Update(static_cast<int64_t>(numTxs));
     }
 
+    // accounts charged for fees were flushed from the cache
+    TransactionFrame::prefetchAccounts(txs, mApp.getDatabase());
+    // only cache hits for transactions validated as part of a tx set, but
+    // replayed ledgers go straight to apply
+    TransactionFrame::preVerifySignatures(txs, mApp);
+
     for (auto tx : txs)
     {
         auto txTime = mTransactionApply.TimeScope();
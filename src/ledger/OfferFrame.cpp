@@ -9,9 +9,12 @@
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/OrderBook.h"
 #include "transactions/ManageOfferOpFrame.h"
 #include "util/types.h"
 
+#include <limits>
+
 using namespace std;
 using namespace soci;
 
@@ -124,7 +127,7 @@ OfferFrame::loadOffer(AccountID const& sellerID, uint64_t offerID, Database& db,
 {
     OfferFrame::pointer retOffer;
 
-    std::string actIDStrKey = KeyUtils::toStrKey(sellerID);
+    std::string actIDStrKey = KeyUtils::toDbKey(sellerID);
 
     std::string sql = offerColumnSelector;
     sql += " WHERE sellerid = :id AND offerid = :offerid";
@@ -180,7 +183,7 @@ OfferFrame::loadOffers(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        oe.sellerID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        oe.sellerID = KeyUtils::fromDbKey<PublicKey>(actIDStrKey);
         if ((buyingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12) ||
             (sellingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12))
             throw std::runtime_error("bad database state");
@@ -198,14 +201,14 @@ OfferFrame::loadOffers(StatementContext& prep,
             if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
                 oe.selling.alphaNum12().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(sellingIssuerStrKey);
+                    KeyUtils::fromDbKey<PublicKey>(sellingIssuerStrKey);
                 strToAssetCode(oe.selling.alphaNum12().assetCode,
                                sellingAssetCode);
             }
             else if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
                 oe.selling.alphaNum4().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(sellingIssuerStrKey);
+                    KeyUtils::fromDbKey<PublicKey>(sellingIssuerStrKey);
                 strToAssetCode(oe.selling.alphaNum4().assetCode,
                                sellingAssetCode);
             }
@@ -222,14 +225,14 @@ OfferFrame::loadOffers(StatementContext& prep,
             if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
                 oe.buying.alphaNum12().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(buyingIssuerStrKey);
+                    KeyUtils::fromDbKey<PublicKey>(buyingIssuerStrKey);
                 strToAssetCode(oe.buying.alphaNum12().assetCode,
                                buyingAssetCode);
             }
             else if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
                 oe.buying.alphaNum4().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(buyingIssuerStrKey);
+                    KeyUtils::fromDbKey<PublicKey>(buyingIssuerStrKey);
                 strToAssetCode(oe.buying.alphaNum4().assetCode,
                                buyingAssetCode);
             }
@@ -244,6 +247,27 @@ void
 OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
                            Asset const& selling, Asset const& buying,
                            vector<OfferFrame::pointer>& retOffers, Database& db)
+{
+    loadBestOffers(numOffers, offset, selling, buying, db,
+                   [&retOffers](LedgerEntry const& of) {
+                       retOffers.emplace_back(make_shared<OfferFrame>(of));
+                   });
+}
+
+void
+OfferFrame::loadOrderBook(
+    Asset const& selling, Asset const& buying, Database& db,
+    std::function<void(LedgerEntry const&)> offerProcessor)
+{
+    loadBestOffers(std::numeric_limits<int64_t>::max(), 0, selling, buying,
+                   db, offerProcessor);
+}
+
+void
+OfferFrame::loadBestOffers(
+    size_t numOffers, size_t offset, Asset const& selling,
+    Asset const& buying, Database& db,
+    std::function<void(LedgerEntry const&)> offerProcessor)
 {
     std::string sql = offerColumnSelector;
 
@@ -263,13 +287,13 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         {
             assetCodeToStr(selling.alphaNum4().assetCode, sellingAssetCode);
             sellingIssuerStrKey =
-                KeyUtils::toStrKey(selling.alphaNum4().issuer);
+                KeyUtils::toDbKey(selling.alphaNum4().issuer);
         }
         else if (selling.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(selling.alphaNum12().assetCode, sellingAssetCode);
             sellingIssuerStrKey =
-                KeyUtils::toStrKey(selling.alphaNum12().issuer);
+                KeyUtils::toDbKey(selling.alphaNum12().issuer);
         }
         else
         {
@@ -289,12 +313,12 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             assetCodeToStr(buying.alphaNum4().assetCode, buyingAssetCode);
-            buyingIssuerStrKey = KeyUtils::toStrKey(buying.alphaNum4().issuer);
+            buyingIssuerStrKey = KeyUtils::toDbKey(buying.alphaNum4().issuer);
         }
         else if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(buying.alphaNum12().assetCode, buyingAssetCode);
-            buyingIssuerStrKey = KeyUtils::toStrKey(buying.alphaNum12().issuer);
+            buyingIssuerStrKey = KeyUtils::toDbKey(buying.alphaNum12().issuer);
         }
         else
         {
@@ -328,9 +352,7 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
     st.exchange(use(offset));
 
     auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of) {
-        retOffers.emplace_back(make_shared<OfferFrame>(of));
-    });
+    loadOffers(prep, offerProcessor);
 }
 
 std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
@@ -352,7 +374,7 @@ OfferFrame::loadAllOffers(Database& db)
 bool
 OfferFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.offer().sellerID);
+    std::string actIDStrKey = KeyUtils::toDbKey(key.offer().sellerID);
     int exists = 0;
     auto timer = db.getSelectTimer("offer-exists");
     auto prep =
@@ -394,6 +416,7 @@ OfferFrame::deleteOffersModifiedOnOrAfterLedger(Database& db,
             return le && le->data.type() == OFFER &&
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
+    db.getOrderBook().clear();
 
     {
         auto prep = db.getPreparedStatement(
@@ -420,6 +443,7 @@ OfferFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     st.exchange(use(key.offer().offerID));
     st.define_and_bind();
     st.execute(true);
+    db.getOrderBook().offerDeleted(key.offer().offerID);
     delta.deleteEntry(key);
 }
 
@@ -446,7 +470,7 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mOffer.sellerID);
+    std::string actIDStrKey = KeyUtils::toDbKey(mOffer.sellerID);
 
     unsigned int sellingType = mOffer.selling.type();
     unsigned int buyingType = mOffer.buying.type();
@@ -457,14 +481,14 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum4().issuer);
+            KeyUtils::toDbKey(mOffer.selling.alphaNum4().issuer);
         assetCodeToStr(mOffer.selling.alphaNum4().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
     else if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum12().issuer);
+            KeyUtils::toDbKey(mOffer.selling.alphaNum12().issuer);
         assetCodeToStr(mOffer.selling.alphaNum12().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
@@ -472,14 +496,14 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum4().issuer);
+            KeyUtils::toDbKey(mOffer.buying.alphaNum4().issuer);
         assetCodeToStr(mOffer.buying.alphaNum4().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
     else if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum12().issuer);
+            KeyUtils::toDbKey(mOffer.buying.alphaNum12().issuer);
         assetCodeToStr(mOffer.buying.alphaNum12().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
@@ -535,6 +559,8 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
         throw std::runtime_error("could not update SQL");
     }
 
+    db.getOrderBook().offerStored(mEntry);
+
     if (insert)
     {
         delta.addEntry(*this);
@@ -548,6 +574,7 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 void
 OfferFrame::dropAll(Database& db)
 {
+    db.getOrderBook().clear();
     db.getSession() << "DROP TABLE IF EXISTS offers;";
     db.getSession() << kSQLCreateStatement1;
     db.getSession() << kSQLCreateStatement2;
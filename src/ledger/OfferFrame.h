@@ -24,6 +24,10 @@ class OfferFrame : public EntryFrame
     static void
     loadOffers(StatementContext& prep,
                std::function<void(LedgerEntry const&)> offerProcessor);
+    static void
+    loadBestOffers(size_t numOffers, size_t offset, Asset const& selling,
+                   Asset const& buying, Database& db,
+                   std::function<void(LedgerEntry const&)> offerProcessor);
 
     double computePrice() const;
 
@@ -94,6 +98,11 @@ class OfferFrame : public EntryFrame
                                std::vector<OfferFrame::pointer>& retOffers,
                                Database& db);
 
+    // load all the offers selling `selling` for `buying`, best first
+    static void
+    loadOrderBook(Asset const& selling, Asset const& buying, Database& db,
+                  std::function<void(LedgerEntry const&)> offerProcessor);
+
     // load all offers from the database (very slow)
     static std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
     loadAllOffers(Database& db);
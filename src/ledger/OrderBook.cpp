@@ -0,0 +1,154 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/OrderBook.h"
+#include "database/Database.h"
+#include "ledger/OfferFrame.h"
+#include "xdrpp/marshal.h"
+
+namespace stellar
+{
+
+const size_t OrderBook::kMaxBooks = 1024;
+
+OrderBook::OfferKey
+OrderBook::getOfferKey(OfferEntry const& offer)
+{
+    return std::make_pair(double(offer.price.n) / double(offer.price.d),
+                          offer.offerID);
+}
+
+std::string
+OrderBook::getBookKey(Asset const& selling, Asset const& buying)
+{
+    auto s = xdr::xdr_to_opaque(selling);
+    auto b = xdr::xdr_to_opaque(buying);
+    std::string res(s.begin(), s.end());
+    res.append(b.begin(), b.end());
+    return res;
+}
+
+OrderBook::Offers const&
+OrderBook::getOffers(Asset const& selling, Asset const& buying, Database& db)
+{
+    auto key = getBookKey(selling, buying);
+    auto it = mBooks.find(key);
+    if (it != mBooks.end())
+    {
+        return it->second.mOffers;
+    }
+
+    if (mBooks.size() >= kMaxBooks)
+    {
+        clear();
+    }
+
+    Book book;
+    OfferFrame::loadOrderBook(selling, buying, db,
+                              [&book](LedgerEntry const& of) {
+                                  auto k = getOfferKey(of.data.offer());
+                                  book.mKeys.emplace(k.second, k);
+                                  book.mOffers.emplace(k, of);
+                              });
+    auto& entry = *mBooks.emplace(key, std::move(book)).first;
+    for (auto const& k : entry.second.mKeys)
+    {
+        mOfferBooks[k.first] = &entry;
+    }
+    return entry.second.mOffers;
+}
+
+void
+OrderBook::removeOffer(uint64_t offerID)
+{
+    auto it = mOfferBooks.find(offerID);
+    if (it == mOfferBooks.end())
+    {
+        return;
+    }
+    auto& b = it->second->second;
+    auto k = b.mKeys.find(offerID);
+    b.mOffers.erase(k->second);
+    b.mKeys.erase(k);
+    mOfferBooks.erase(it);
+}
+
+void
+OrderBook::eraseBook(std::string const& key)
+{
+    auto it = mBooks.find(key);
+    if (it == mBooks.end())
+    {
+        return;
+    }
+    for (auto const& k : it->second.mKeys)
+    {
+        mOfferBooks.erase(k.first);
+    }
+    mBooks.erase(it);
+}
+
+void
+OrderBook::offerStored(LedgerEntry const& offer)
+{
+    auto const& oe = offer.data.offer();
+    auto key = getBookKey(oe.selling, oe.buying);
+
+    auto old = mOfferBooks.find(oe.offerID);
+    if (old != mOfferBooks.end() && old->second->first != key)
+    {
+        removeOffer(oe.offerID);
+    }
+
+    auto it = mBooks.find(key);
+    if (it == mBooks.end())
+    {
+        return;
+    }
+
+    auto& b = it->second;
+    auto k = getOfferKey(oe);
+    auto prev = b.mKeys.find(oe.offerID);
+    if (prev != b.mKeys.end())
+    {
+        b.mOffers.erase(prev->second);
+        prev->second = k;
+    }
+    else
+    {
+        b.mKeys.emplace(oe.offerID, k);
+        mOfferBooks[oe.offerID] = &*it;
+    }
+    b.mOffers[k] = offer;
+}
+
+void
+OrderBook::offerDeleted(uint64_t offerID)
+{
+    removeOffer(offerID);
+}
+
+void
+OrderBook::flushOffer(uint64_t offerID)
+{
+    auto it = mOfferBooks.find(offerID);
+    if (it != mOfferBooks.end())
+    {
+        eraseBook(it->second->first);
+    }
+}
+
+void
+OrderBook::flushBook(Asset const& selling, Asset const& buying)
+{
+    eraseBook(getBookKey(selling, buying));
+}
+
+void
+OrderBook::clear()
+{
+    mBooks.clear();
+    mOfferBooks.clear();
+}
+}
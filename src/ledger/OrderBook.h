@@ -0,0 +1,78 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace stellar
+{
+class Database;
+
+/*
+OrderBook
+In-memory copy of the offers of the asset pairs that were crossed recently.
+
+A book is loaded from the database the first time its asset pair is crossed
+and is then kept up to date by OfferFrame's store methods. Like the entry
+cache, a book only reflects the database as long as all changes go through
+the frames. When a LedgerDelta rolls back a change to an offer, the book
+holding the offer and the book of the value restored in the database are
+dropped (a book loaded after the change misses the restored offer), which is
+how rolled back changes are discarded.
+*/
+class OrderBook : NonMovableOrCopyable
+{
+  public:
+    // offers are ordered the same way as OfferFrame::loadBestOffers:
+    // by price (n/d as stored in the database) then by offer id
+    typedef std::pair<double, uint64_t> OfferKey;
+    typedef std::map<OfferKey, LedgerEntry> Offers;
+
+    static OfferKey getOfferKey(OfferEntry const& offer);
+
+    // returns the offers selling `selling` for `buying`, loading them from
+    // the database if the book is not in memory
+    Offers const& getOffers(Asset const& selling, Asset const& buying,
+                            Database& db);
+
+    // called after an offer was inserted or updated in the database
+    void offerStored(LedgerEntry const& offer);
+    // called after an offer was deleted from the database
+    void offerDeleted(uint64_t offerID);
+    // forgets about the book holding the offer, if any
+    void flushOffer(uint64_t offerID);
+    // forgets about the book of an asset pair
+    void flushBook(Asset const& selling, Asset const& buying);
+
+    void clear();
+
+  private:
+    struct Book
+    {
+        Offers mOffers;
+        std::unordered_map<uint64_t, OfferKey> mKeys;
+    };
+
+    typedef std::unordered_map<std::string, Book> Books;
+
+    // bound on the number of books kept in memory, reaching it clears them
+    static const size_t kMaxBooks;
+
+    static std::string getBookKey(Asset const& selling, Asset const& buying);
+
+    Books mBooks;
+    // book of each offer held by a book (elements of mBooks keep their
+    // address until they are erased)
+    std::unordered_map<uint64_t, Books::value_type*> mOfferBooks;
+
+    void removeOffer(uint64_t offerID);
+    void eraseBook(std::string const& key);
+};
+}
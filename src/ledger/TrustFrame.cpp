@@ -65,17 +65,17 @@ void
 TrustFrame::getKeyFields(LedgerKey const& key, std::string& actIDStrKey,
                          std::string& issuerStrKey, std::string& assetCode)
 {
-    actIDStrKey = KeyUtils::toStrKey(key.trustLine().accountID);
+    actIDStrKey = KeyUtils::toDbKey(key.trustLine().accountID);
     if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         issuerStrKey =
-            KeyUtils::toStrKey(key.trustLine().asset.alphaNum4().issuer);
+            KeyUtils::toDbKey(key.trustLine().asset.alphaNum4().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum4().assetCode, assetCode);
     }
     else if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         issuerStrKey =
-            KeyUtils::toStrKey(key.trustLine().asset.alphaNum12().issuer);
+            KeyUtils::toDbKey(key.trustLine().asset.alphaNum12().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum12().assetCode, assetCode);
     }
 
@@ -362,16 +362,16 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
 
     std::string accStr, issuerStr, assetStr;
 
-    accStr = KeyUtils::toStrKey(accountID);
+    accStr = KeyUtils::toDbKey(accountID);
     if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         assetCodeToStr(asset.alphaNum4().assetCode, assetStr);
-        issuerStr = KeyUtils::toStrKey(asset.alphaNum4().issuer);
+        issuerStr = KeyUtils::toDbKey(asset.alphaNum4().issuer);
     }
     else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         assetCodeToStr(asset.alphaNum12().assetCode, assetStr);
-        issuerStr = KeyUtils::toStrKey(asset.alphaNum12().issuer);
+        issuerStr = KeyUtils::toDbKey(asset.alphaNum12().issuer);
     }
 
     auto query = std::string(trustLineColumnSelector);
@@ -444,18 +444,18 @@ TrustFrame::loadLines(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        tl.accountID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        tl.accountID = KeyUtils::fromDbKey<PublicKey>(actIDStrKey);
         tl.asset.type((AssetType)assetType);
         if (assetType == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             tl.asset.alphaNum4().issuer =
-                KeyUtils::fromStrKey<PublicKey>(issuerStrKey);
+                KeyUtils::fromDbKey<PublicKey>(issuerStrKey);
             strToAssetCode(tl.asset.alphaNum4().assetCode, assetCode);
         }
         else if (assetType == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             tl.asset.alphaNum12().issuer =
-                KeyUtils::fromStrKey<PublicKey>(issuerStrKey);
+                KeyUtils::fromDbKey<PublicKey>(issuerStrKey);
             strToAssetCode(tl.asset.alphaNum12().assetCode, assetCode);
         }
 
@@ -470,7 +470,7 @@ TrustFrame::loadLines(AccountID const& accountID,
                       std::vector<TrustFrame::pointer>& retLines, Database& db)
 {
     std::string actIDStrKey;
-    actIDStrKey = KeyUtils::toStrKey(accountID);
+    actIDStrKey = KeyUtils::toDbKey(accountID);
 
     auto query = std::string(trustLineColumnSelector);
     query += (" WHERE accountid = :id ");
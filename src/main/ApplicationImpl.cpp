@@ -122,6 +122,9 @@ ApplicationImpl::initialize()
     mBanManager = BanManager::create(*this);
     mStatusManager = std::make_unique<StatusManager>();
 
+    // the verification cache is process-wide, last application wins
+    PubKeyUtils::setVerifySigCacheSize(mConfig.VERIFY_SIG_CACHE_SIZE);
+
     BucketListIsConsistentWithDatabase::registerInvariant(*this);
     AccountSubEntriesCountIsValid::registerInvariant(*this);
     CacheIsConsistentWithDatabase::registerInvariant(*this);
@@ -45,7 +45,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     LEDGER_PROTOCOL_VERSION = CURRENT_LEDGER_PROTOCOL_VERSION;
 
     OVERLAY_PROTOCOL_MIN_VERSION = 6;
-    OVERLAY_PROTOCOL_VERSION = 7;
+    OVERLAY_PROTOCOL_VERSION = 11;
 
     VERSION_STR = STELLAR_CORE_VERSION;
 
@@ -87,6 +87,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MINIMUM_IDLE_PERCENT = 0;
 
     MAX_CONCURRENT_SUBPROCESSES = 16;
+    VERIFY_SIG_CACHE_SIZE = 0xffff;
     NODE_IS_VALIDATOR = false;
 
     DATABASE = SecretValue{"sqlite3://:memory:"};
@@ -436,6 +437,11 @@ Config::load(std::string const& filename)
                 MAX_CONCURRENT_SUBPROCESSES =
                     static_cast<size_t>(readInt<int>(item, 1));
             }
+            else if (item.first == "VERIFY_SIG_CACHE_SIZE")
+            {
+                VERIFY_SIG_CACHE_SIZE =
+                    static_cast<size_t>(readInt<int>(item, 1));
+            }
             else if (item.first == "MINIMUM_IDLE_PERCENT")
             {
                 MINIMUM_IDLE_PERCENT = readInt<uint32_t>(item, 0, 100);
@@ -184,6 +184,9 @@ class Config : public std::enable_shared_from_this<Config>
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
+    // number of signature verification results kept in memory
+    size_t VERIFY_SIG_CACHE_SIZE;
+
     // SCP config
     SecretKey NODE_SEED;
     bool NODE_IS_VALIDATOR;
@@ -10,16 +10,22 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "overlay/LoopbackPeer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerDoor.h"
 #include "simulation/Simulation.h"
 #include "simulation/Topologies.h"
 #include "test/TestAccount.h"
+#include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
 namespace stellar
 {
 using namespace txtest;
@@ -36,6 +42,19 @@ TEST_CASE("Flooding", "[flood][overlay]")
         return cfg;
     };
 
+    // odd nodes speak the overlay version preceding `version`, so they do
+    // not support the feature it introduced
+    auto mixedCfgGen = [&](uint32_t version) {
+        return [&cfgGen, version](int cfgNum) {
+            Config cfg = cfgGen(cfgNum);
+            if (cfgNum % 2 == 1)
+            {
+                cfg.OVERLAY_PROTOCOL_VERSION = version - 1;
+            }
+            return cfg;
+        };
+    };
+
     const int nbTx = 100;
 
     std::vector<TestAccount> sources;
@@ -180,6 +199,33 @@ TEST_CASE("Flooding", "[flood][overlay]")
                                               networkID, cfgGen);
                 test(injectTransaction, ackedTransactions);
             }
+            SECTION("loopback with push mode peers")
+            {
+                // transactions are pushed to and from the odd nodes, and
+                // pulled between the even ones
+                simulation = Topologies::core(
+                    4, .666f, Simulation::OVER_LOOPBACK, networkID,
+                    mixedCfgGen(FIRST_OVERLAY_VERSION_WITH_PULL_MODE));
+                test(injectTransaction, ackedTransactions);
+            }
+            SECTION("loopback with peers not batching transactions")
+            {
+                // demanded transactions are sent one by one to and from the
+                // odd nodes, and in batches between the even ones
+                simulation = Topologies::core(
+                    4, .666f, Simulation::OVER_LOOPBACK, networkID,
+                    mixedCfgGen(FIRST_OVERLAY_VERSION_WITH_TX_BATCH));
+                test(injectTransaction, ackedTransactions);
+
+                uint64_t batches = 0;
+                for (auto n : nodes)
+                {
+                    auto& sent = n->getMetrics().NewMeter(
+                        {"overlay", "send", "transactions"}, "message");
+                    batches += sent.count();
+                }
+                REQUIRE(batches > 0);
+            }
         }
 
         SECTION("outer nodes")
@@ -314,6 +360,29 @@ TEST_CASE("Flooding", "[flood][overlay]")
                     Topologies::core(4, .666f, Simulation::OVER_LOOPBACK,
                                      networkID, cfgGen, quorumAdjuster);
                 test(injectSCP, ackedSCP);
+
+                // the transactions of the tx sets are not flooded, they are
+                // sent on request along with the compact form of the sets
+                uint64_t complete = 0, missing = 0, fallback = 0;
+                for (auto n : nodes)
+                {
+                    auto& m = n->getMetrics();
+                    complete += m.NewMeter({"overlay", "compact-txset",
+                                            "complete"},
+                                           "txset")
+                                    .count();
+                    missing += m.NewMeter({"overlay", "compact-txset",
+                                           "missing"},
+                                          "transaction")
+                                   .count();
+                    fallback += m.NewMeter({"overlay", "compact-txset",
+                                            "fallback"},
+                                           "txset")
+                                    .count();
+                }
+                REQUIRE(complete > 0);
+                REQUIRE(missing > 0);
+                REQUIRE(fallback == 0);
             }
             SECTION("tcp")
             {
@@ -322,6 +391,14 @@ TEST_CASE("Flooding", "[flood][overlay]")
                                      cfgGen, quorumAdjuster);
                 test(injectSCP, ackedSCP);
             }
+            SECTION("loopback with peers fetching full tx sets")
+            {
+                simulation = Topologies::core(
+                    4, .666f, Simulation::OVER_LOOPBACK, networkID,
+                    mixedCfgGen(FIRST_OVERLAY_VERSION_WITH_COMPACT_TX_SET),
+                    quorumAdjuster);
+                test(injectSCP, ackedSCP);
+            }
         }
 
         SECTION("outer nodes")
@@ -343,4 +420,199 @@ TEST_CASE("Flooding", "[flood][overlay]")
         }
     }
 }
+
+TEST_CASE("transaction pull mode", "[flood][overlay]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig(0));
+    auto a = createTestApplication(clock, getTestConfig(1));
+    auto b = createTestApplication(clock, getTestConfig(2));
+    for (auto node : {app, a, b})
+    {
+        node->start();
+    }
+
+    LoopbackPeerConnection connA(*a, *app);
+    LoopbackPeerConnection connB(*b, *app);
+    testutil::crankSome(clock);
+    REQUIRE(connA.getAcceptor()->isAuthenticated());
+    REQUIRE(connB.getAcceptor()->isAuthenticated());
+
+    auto crankFor = [&](VirtualClock::duration d) {
+        auto end = clock.now() + d;
+        while (clock.now() < end && clock.crank(false) > 0)
+            ;
+    };
+
+    // gives `tx` to `node`, which advertises it to `app`
+    auto inject = [&](Application& node, TransactionFramePtr const& tx) {
+        auto copy = TransactionFrame::makeTransactionFromWire(
+            node.getNetworkID(), tx->getEnvelope());
+        REQUIRE(node.getHerder().recvTransaction(copy) ==
+                Herder::TX_STATUS_PENDING);
+        node.getOverlayManager().broadcastMessage(copy->toStellarMessage());
+    };
+
+    auto root = TestAccount::createRoot(*a);
+    auto amount = a->getLedgerManager().getMinBalance(0);
+    auto makeTx = [&]() {
+        return root.tx(
+            {createAccount(SecretKey::random().getPublicKey(), amount)});
+    };
+
+    auto& demands = app->getMetrics().NewMeter(
+        {"overlay", "send", "flood-demand"}, "message");
+
+    SECTION("adverts are batched")
+    {
+        std::vector<TransactionFramePtr> txs;
+        for (int i = 0; i < 3; i++)
+        {
+            txs.emplace_back(makeTx());
+            inject(*a, txs.back());
+        }
+        crankFor(std::chrono::seconds(1));
+
+        for (auto const& tx : txs)
+        {
+            REQUIRE(app->getHerder().getTx(tx->getFullHash()));
+        }
+        // one advert and one demand for all of them
+        REQUIRE(a->getMetrics()
+                    .NewMeter({"overlay", "send", "flood-advert"}, "message")
+                    .count() == 1);
+        REQUIRE(demands.count() == 1);
+    }
+
+    SECTION("demanded transactions are admitted in batch order")
+    {
+        // each transaction depends on the previous one, any reordering
+        // gets the later ones rejected
+        std::vector<TransactionFramePtr> txs;
+        for (int i = 0; i < 10; i++)
+        {
+            txs.emplace_back(makeTx());
+            inject(*a, txs.back());
+        }
+        crankFor(std::chrono::seconds(1));
+
+        auto& m = app->getMetrics();
+        REQUIRE(m.NewTimer({"overlay", "recv", "transactions"}).count() == 1);
+        REQUIRE(m.NewTimer({"overlay", "recv", "transaction"}).count() == 0);
+        REQUIRE(app->getHerder().getMaxSeqInPendingTxs(root) ==
+                txs.back()->getSeqNum());
+    }
+
+    SECTION("unanswered demand is sent to the next advertiser")
+    {
+        auto tx = makeTx();
+
+        // the demand sent to `a` never reaches it
+        connA.getAcceptor()->setCorked(true);
+        inject(*a, tx);
+        crankFor(std::chrono::milliseconds(500));
+        REQUIRE(demands.count() == 1);
+
+        // `b` is not asked until the demand sent to `a` times out
+        inject(*b, tx);
+        crankFor(std::chrono::milliseconds(300));
+        REQUIRE(demands.count() == 1);
+        REQUIRE(!app->getHerder().getTx(tx->getFullHash()));
+
+        crankFor(std::chrono::seconds(1));
+        REQUIRE(demands.count() == 2);
+        REQUIRE(app->getHerder().getTx(tx->getFullHash()));
+
+        // neither of them is told about the transaction it advertised
+        REQUIRE(b->getMetrics()
+                    .NewTimer({"overlay", "recv", "flood-advert"})
+                    .count() == 0);
+    }
+
+    SECTION("invalid transactions are not demanded again")
+    {
+        // the source account does not exist: `app` rejects the
+        // transaction, which its advertisers never checked
+        TestAccount missing{*a, SecretKey::random(), 1};
+        auto tx = missing.tx({payment(root, 1)});
+        auto msg = tx->toStellarMessage();
+
+        connA.getInitiator()->sendMessage(msg);
+        crankFor(std::chrono::seconds(1));
+        REQUIRE(!app->getHerder().getTx(tx->getFullHash()));
+
+        // adverts for it are ignored, whichever peer sends them
+        REQUIRE(!app->getOverlayManager().recvTxAdvert(
+            tx->getFullHash(), connA.getAcceptor()));
+        b->getOverlayManager().broadcastMessage(msg);
+        crankFor(std::chrono::seconds(2));
+        REQUIRE(demands.count() == 0);
+    }
+}
+
+TEST_CASE("compact tx set short id collision", "[flood][overlay]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig(0));
+    auto a = createTestApplication(clock, getTestConfig(1));
+    app->start();
+    a->start();
+
+    LoopbackPeerConnection conn(*a, *app);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isCompactTxSetEnabled());
+
+    auto root = TestAccount::createRoot(*app);
+    auto amount = app->getLedgerManager().getMinBalance(0);
+    auto pending =
+        root.tx({createAccount(SecretKey::random().getPublicKey(), amount)});
+    auto other =
+        root.tx({createAccount(SecretKey::random().getPublicKey(), amount)});
+    REQUIRE(app->getHerder().recvTransaction(pending) ==
+            Herder::TX_STATUS_PENDING);
+
+    auto const& lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+    TxSetFrame txSet(lcl.hash);
+    txSet.add(other);
+    txSet.sortForHash();
+
+    // the short id of the transaction in the set is the one of a pending
+    // transaction, as if their short hashes were the same
+    auto id = Peer::getShortTxID(txSet.getContentsHash(),
+                                 pending->getFullHash());
+    StellarMessage msg;
+    msg.type(COMPACT_TX_SET);
+    msg.compactTxSet().txSetHash = txSet.getContentsHash();
+    msg.compactTxSet().previousLedgerHash = lcl.hash;
+    msg.compactTxSet().txs.emplace_back(id);
+
+    auto& m = app->getMetrics();
+    auto& requests =
+        m.NewMeter({"overlay", "send", "get-compact-txset"}, "message");
+
+    // a compact tx set that was not asked for is ignored
+    conn.getInitiator()->sendMessage(msg);
+    testutil::crankSome(clock);
+    REQUIRE(requests.count() == 0);
+    REQUIRE(m.NewMeter({"overlay", "compact-txset", "fallback"}, "txset")
+                .count() == 0);
+
+    // `app` asks `a`, which does not have it, and gets the forged answer
+    // before the one of `a`
+    conn.getAcceptor()->sendGetTxSet(txSet.getContentsHash());
+    conn.getInitiator()->sendMessage(msg);
+    testutil::crankSome(clock);
+    REQUIRE(requests.count() == 1);
+
+    // the rebuilt set does not have the right hash, the full set is fetched
+    REQUIRE(m.NewMeter({"overlay", "compact-txset", "complete"}, "txset")
+                .count() == 0);
+    REQUIRE(m.NewMeter({"overlay", "compact-txset", "fallback"}, "txset")
+                .count() == 1);
+    REQUIRE(m.NewMeter({"overlay", "send", "get-txset"}, "message").count() ==
+            1);
+    REQUIRE(a->getMetrics()
+                .NewTimer({"overlay", "recv", "get-txset"})
+                .count() == 1);
+}
 }
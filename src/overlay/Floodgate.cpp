@@ -13,6 +13,8 @@
 #include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
+#include <cassert>
 
 namespace stellar
 {
@@ -30,10 +32,20 @@ Floodgate::Floodgate(Application& app)
           app.getMetrics().NewCounter({"overlay", "memory", "flood-map"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "message", "send-from-broadcast"}, "message"))
+    , mIgnoredTxAdverts(app.getMetrics().NewMeter(
+          {"overlay", "flood", "advert-ignored"}, "transaction"))
     , mShuttingDown(false)
 {
 }
 
+// an unanswered demand for a transaction is sent to the next peer that
+// advertised it after that time
+static std::chrono::milliseconds const TX_DEMAND_TIMEOUT(1000);
+
+// limits on the transactions being demanded, beyond which adverts are ignored
+static size_t const TX_DEMAND_MAX_PER_PEER = 2000;
+static size_t const TX_DEMAND_MAX = 20000;
+
 // remove old flood records
 void
 Floodgate::clearBelow(uint32_t currentLedger)
@@ -43,6 +55,10 @@ Floodgate::clearBelow(uint32_t currentLedger)
         // give one ledger of leeway
         if (it->second->mLedgerSeq + 10 < currentLedger)
         {
+            {
+                std::lock_guard<std::mutex> lock(mKnownMutex);
+                mKnown.erase(it->first);
+            }
             mFloodMap.erase(it++);
         }
         else
@@ -50,6 +66,28 @@ Floodgate::clearBelow(uint32_t currentLedger)
             ++it;
         }
     }
+    for (auto it = mRejectedTxs.begin(); it != mRejectedTxs.end();)
+    {
+        if (it->second + 10 < currentLedger)
+        {
+            it = mRejectedTxs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    for (auto it = mTxIndex.begin(); it != mTxIndex.end();)
+    {
+        if (mFloodMap.find(it->second) == mFloodMap.end())
+        {
+            it = mTxIndex.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
     mFloodMapSize.set_count(mFloodMap.size());
 }
 
@@ -67,6 +105,8 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
         mFloodMap[index] = std::make_shared<FloodRecord>(
             msg, mApp.getHerder().getCurrentLedgerSeq(), peer);
         mFloodMapSize.set_count(mFloodMap.size());
+        std::lock_guard<std::mutex> lock(mKnownMutex);
+        mKnown.insert(index);
         return true;
     }
     else
@@ -76,6 +116,27 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
     }
 }
 
+void
+Floodgate::addPeer(Hash const& index, Peer::pointer peer)
+{
+    if (mShuttingDown)
+    {
+        return;
+    }
+    auto result = mFloodMap.find(index);
+    if (result != mFloodMap.end())
+    {
+        result->second->mPeersTold.insert(peer);
+    }
+}
+
+bool
+Floodgate::isKnown(Hash const& index) const
+{
+    std::lock_guard<std::mutex> lock(mKnownMutex);
+    return mKnown.find(index) != mKnown.end();
+}
+
 // send message to anyone you haven't gotten it from
 void
 Floodgate::broadcast(StellarMessage const& msg, bool force)
@@ -84,9 +145,21 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     {
         return;
     }
-    Hash index = sha256(xdr::xdr_to_opaque(msg));
+    // serialized and hashed once, whatever the number of peers
+    auto serialized = std::make_shared<SerializedMessage const>(msg);
+    Hash const& index = serialized->getHash();
     CLOG(TRACE, "Overlay") << "broadcast " << hexAbbrev(index);
 
+    // the full hash of a transaction is the hash of its envelope, which is
+    // encoded right after the message type
+    bool advert = msg.type() == TRANSACTION;
+    Hash txHash;
+    if (advert)
+    {
+        auto const& bytes = serialized->getBytes();
+        txHash = sha256(ByteSlice(bytes.data() + 4, bytes.size() - 4));
+    }
+
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end() || force)
     { // no one has sent us this message
@@ -94,10 +167,31 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
             msg, mApp.getHerder().getCurrentLedgerSeq(), Peer::pointer());
         result = mFloodMap.insert(std::make_pair(index, record)).first;
         mFloodMapSize.set_count(mFloodMap.size());
+        std::lock_guard<std::mutex> lock(mKnownMutex);
+        mKnown.insert(index);
     }
     // send it to people that haven't sent it to us
     std::set<Peer::pointer>& peersTold = result->second->mPeersTold;
 
+    if (advert)
+    {
+        mTxIndex[txHash] = index;
+        // the peers that advertised it to us have it
+        auto demand = mTxDemands.find(txHash);
+        if (demand != mTxDemands.end())
+        {
+            for (auto const& weak : demand->second->mAdvertisers)
+            {
+                auto peer = weak.lock();
+                if (peer)
+                {
+                    peersTold.insert(peer);
+                }
+            }
+            eraseTxDemand(demand);
+        }
+    }
+
     // make a copy, in case peers gets modified
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
 
@@ -107,7 +201,14 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
         if (peersTold.find(peer.second) == peersTold.end())
         {
             mSendFromBroadcast.Mark();
-            peer.second->sendMessage(msg);
+            if (advert && peer.second->isPullModeEnabled())
+            {
+                peer.second->queueTxAdvert(txHash);
+            }
+            else
+            {
+                peer.second->sendMessage(serialized);
+            }
             peersTold.insert(peer.second);
         }
     }
@@ -115,6 +216,143 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
                            << peersTold.size();
 }
 
+bool
+Floodgate::recvTxAdvert(Hash const& txHash, Peer::pointer peer)
+{
+    if (mShuttingDown)
+    {
+        return false;
+    }
+
+    // we have it already, just do not advertise it back
+    auto index = mTxIndex.find(txHash);
+    if (index != mTxIndex.end())
+    {
+        addPeer(index->second, peer);
+        return false;
+    }
+    if (mRejectedTxs.find(txHash) != mRejectedTxs.end() ||
+        mApp.getHerder().getTx(txHash))
+    {
+        return false;
+    }
+
+    auto it = mTxDemands.find(txHash);
+    if (it != mTxDemands.end())
+    {
+        auto const& advertisers = it->second->mAdvertisers;
+        if (std::none_of(advertisers.begin(), advertisers.end(),
+                         [&peer](std::weak_ptr<Peer> const& advertiser) {
+                             return advertiser.lock() == peer;
+                         }))
+        {
+            addTxAdvertiser(*it->second, peer);
+        }
+        return false;
+    }
+
+    if (mTxDemands.size() >= TX_DEMAND_MAX)
+    {
+        mIgnoredTxAdverts.Mark();
+        return false;
+    }
+    auto demand = std::make_unique<TxDemand>(mApp);
+    if (!addTxAdvertiser(*demand, peer))
+    {
+        return false;
+    }
+    demand->mNext = 1;
+    startTxDemandTimer(txHash, *demand);
+    mTxDemands.emplace(txHash, std::move(demand));
+    return true;
+}
+
+bool
+Floodgate::addTxAdvertiser(TxDemand& demand, Peer::pointer const& peer)
+{
+    auto& count = mPeerTxDemands[peer];
+    if (count >= TX_DEMAND_MAX_PER_PEER)
+    {
+        mIgnoredTxAdverts.Mark();
+        return false;
+    }
+    count++;
+    demand.mAdvertisers.emplace_back(peer);
+    return true;
+}
+
+void
+Floodgate::eraseTxDemand(TxDemands::iterator it)
+{
+    for (auto const& advertiser : it->second->mAdvertisers)
+    {
+        auto count = mPeerTxDemands.find(advertiser);
+        assert(count != mPeerTxDemands.end());
+        if (--count->second == 0)
+        {
+            mPeerTxDemands.erase(count);
+        }
+    }
+    mTxDemands.erase(it);
+}
+
+void
+Floodgate::rejectTx(Hash const& txHash)
+{
+    if (mShuttingDown)
+    {
+        return;
+    }
+    mRejectedTxs[txHash] = mApp.getHerder().getCurrentLedgerSeq();
+    auto it = mTxDemands.find(txHash);
+    if (it != mTxDemands.end())
+    {
+        eraseTxDemand(it);
+    }
+}
+
+void
+Floodgate::startTxDemandTimer(Hash const& txHash, TxDemand& demand)
+{
+    demand.mTimer.expires_from_now(TX_DEMAND_TIMEOUT);
+    demand.mTimer.async_wait([this, txHash]() { retryTxDemand(txHash); },
+                             VirtualTimer::onFailureNoop);
+}
+
+void
+Floodgate::retryTxDemand(Hash const& txHash)
+{
+    auto it = mTxDemands.find(txHash);
+    if (it == mTxDemands.end())
+    {
+        return;
+    }
+
+    // the transaction may have become pending in the meantime
+    auto& demand = *it->second;
+    if (!mApp.getHerder().getTx(txHash))
+    {
+        while (demand.mNext < demand.mAdvertisers.size())
+        {
+            auto peer = demand.mAdvertisers[demand.mNext++].lock();
+            if (peer && peer->isAuthenticated())
+            {
+                CLOG(TRACE, "Overlay") << "demand " << hexAbbrev(txHash)
+                                       << " again from " << peer->toString();
+                StellarMessage msg;
+                msg.type(FLOOD_DEMAND);
+                msg.floodDemand().txHashes.emplace_back(txHash);
+                peer->sendMessage(msg);
+                startTxDemandTimer(txHash, demand);
+                return;
+            }
+        }
+    }
+
+    // nobody else advertised it, the next advert starts over
+    eraseTxDemand(it);
+}
+
 std::set<Peer::pointer>
 Floodgate::getPeersKnows(Hash const& h)
 {
@@ -132,5 +370,11 @@ Floodgate::shutdown()
 {
     mShuttingDown = true;
     mFloodMap.clear();
+    mTxDemands.clear();
+    mPeerTxDemands.clear();
+    mTxIndex.clear();
+    mRejectedTxs.clear();
+    std::lock_guard<std::mutex> lock(mKnownMutex);
+    mKnown.clear();
 }
 }
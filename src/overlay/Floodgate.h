@@ -6,7 +6,14 @@
 
 #include "overlay/Peer.h"
 #include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
+#include "util/Timer.h"
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -16,6 +23,11 @@
  *
  * The broadcast message types are TRANSACTION and SCP_MESSAGE.
  *
+ * Peers that support pull mode (overlay version 8 and above) are sent
+ * transactions in two steps: the hashes of the transactions are advertised
+ * to them in batches, and they demand the ones they do not have, from one
+ * of the peers that advertised them at a time.
+ *
  * All messages are marked with the ledger sequence number to which they
  * relate, and all flood-management information for a given ledger number
  * is purged from the FloodGate when the ledger closes.
@@ -45,11 +57,47 @@ class Floodgate
     };
 
     std::map<uint256, FloodRecord::pointer> mFloodMap;
+    // the keys of mFloodMap, for the other threads
+    mutable std::mutex mKnownMutex;
+    std::unordered_set<uint256> mKnown;
+    // a transaction that was advertised to us and demanded from a peer
+    struct TxDemand
+    {
+        // peers that advertised the transaction, in order; the ones before
+        // mNext were already asked for it
+        std::vector<std::weak_ptr<Peer>> mAdvertisers;
+        size_t mNext{0};
+        // asks the next advertiser when the current demand times out
+        VirtualTimer mTimer;
+
+        explicit TxDemand(Application& app) : mTimer(app)
+        {
+        }
+    };
+    typedef std::unordered_map<Hash, std::unique_ptr<TxDemand>> TxDemands;
+    // by full hash of the transaction
+    TxDemands mTxDemands;
+    // number of entries of mTxDemands each peer advertised
+    std::map<std::weak_ptr<Peer>, size_t, std::owner_less<std::weak_ptr<Peer>>>
+        mPeerTxDemands;
+    // index in mFloodMap of the transactions we broadcast, by full hash
+    std::unordered_map<Hash, Hash> mTxIndex;
+    // transactions that failed validation, by full hash, with the ledger
+    // they were rejected in; they are not demanded again
+    std::unordered_map<Hash, uint32_t> mRejectedTxs;
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
+    medida::Meter& mIgnoredTxAdverts;
     bool mShuttingDown;
 
+    // returns false if `peer` has too many outstanding demands already
+    bool addTxAdvertiser(TxDemand& demand, Peer::pointer const& peer);
+    void eraseTxDemand(TxDemands::iterator it);
+    void startTxDemandTimer(Hash const& txHash, TxDemand& demand);
+    // demands the transaction from its next advertiser, if any
+    void retryTxDemand(Hash const& txHash);
+
   public:
     Floodgate(Application& app);
     // Floodgate will be cleared after every ledger close
@@ -57,8 +105,27 @@ class Floodgate
     // returns true if this is a new record
     bool addRecord(StellarMessage const& msg, Peer::pointer fromPeer);
 
+    // records that `fromPeer` sent us the message with hash `index`, if
+    // there is a record for it
+    void addPeer(Hash const& index, Peer::pointer fromPeer);
+    // returns true if there is a record for the message with hash `index`;
+    // can be called from any thread
+    bool isKnown(Hash const& index) const;
+
+    // sends the message to the peers that do not have it yet; transactions
+    // are only advertised to the peers that pull them
     void broadcast(StellarMessage const& msg, bool force);
 
+    // records that `peer` advertised the transaction with full hash
+    // `txHash`; returns true if it should be demanded from that peer, which
+    // is only the case for the first peer advertising a transaction we do not
+    // have: the other ones are asked in turn, each time a demand times out
+    bool recvTxAdvert(Hash const& txHash, Peer::pointer peer);
+
+    // records that the transaction with full hash `txHash` failed
+    // validation, so that it is not demanded again
+    void rejectTx(Hash const& txHash);
+
     // returns the list of peers that sent us the item with hash `h`
     std::set<Peer::pointer> getPeersKnows(Hash const& h);
 
@@ -0,0 +1,135 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/FlowControl.h"
+#include "overlay/OutboundQueue.h"
+
+namespace stellar
+{
+
+static uint32_t const CAPACITY_MESSAGES = 200;
+static uint32_t const CAPACITY_BYTES = 2 * 1024 * 1024;
+static uint32_t const CAPACITY_SCP_MESSAGES = 100;
+
+// credits are granted back once a quarter of the capacity was used, so that
+// the peer gets them before running out
+static int64_t const GRANT_DIVISOR = 4;
+
+SendMore
+FlowControl::getCapacity()
+{
+    SendMore res;
+    res.numMessages = CAPACITY_MESSAGES;
+    res.numBytes = CAPACITY_BYTES;
+    res.numSCPMessages = CAPACITY_SCP_MESSAGES;
+    return res;
+}
+
+bool
+FlowControl::isFlowControlled(MessageType type)
+{
+    return OutboundQueue::getClass(type) != OutboundQueue::CONTROL;
+}
+
+SendMore
+FlowControl::start()
+{
+    auto capacity = getCapacity();
+    mEnabled = true;
+    mInbound.mMessages = capacity.numMessages;
+    mInbound.mBytes = capacity.numBytes;
+    mInbound.mSCPMessages = capacity.numSCPMessages;
+    return capacity;
+}
+
+bool
+FlowControl::take(Credits& credits, MessageType type, size_t size)
+{
+    if (OutboundQueue::getClass(type) == OutboundQueue::SCP)
+    {
+        if (credits.mSCPMessages <= 0)
+        {
+            return false;
+        }
+        credits.mSCPMessages--;
+        return true;
+    }
+
+    if (credits.mMessages <= 0 || credits.mBytes <= 0)
+    {
+        return false;
+    }
+    credits.mMessages--;
+    credits.mBytes -= static_cast<int64_t>(size);
+    return true;
+}
+
+bool
+FlowControl::trySend(SerializedMessage const& msg)
+{
+    if (!mEnabled || !isFlowControlled(msg.getType()))
+    {
+        return true;
+    }
+    return take(mOutbound, msg.getType(), msg.getBytes().size());
+}
+
+void
+FlowControl::addCredits(SendMore const& credits)
+{
+    mOutbound.mMessages += credits.numMessages;
+    mOutbound.mBytes += credits.numBytes;
+    mOutbound.mSCPMessages += credits.numSCPMessages;
+}
+
+bool
+FlowControl::received(MessageType type, size_t size)
+{
+    if (!mEnabled || !isFlowControlled(type))
+    {
+        return true;
+    }
+    return take(mInbound, type, size);
+}
+
+void
+FlowControl::processed(MessageType type, size_t size)
+{
+    if (!mEnabled || !isFlowControlled(type))
+    {
+        return;
+    }
+
+    if (OutboundQueue::getClass(type) == OutboundQueue::SCP)
+    {
+        mUsed.mSCPMessages++;
+    }
+    else
+    {
+        mUsed.mMessages++;
+        mUsed.mBytes += static_cast<int64_t>(size);
+    }
+}
+
+bool
+FlowControl::getCreditsToGrant(SendMore& credits)
+{
+    auto capacity = getCapacity();
+    if (mUsed.mMessages < capacity.numMessages / GRANT_DIVISOR &&
+        mUsed.mBytes < capacity.numBytes / GRANT_DIVISOR &&
+        mUsed.mSCPMessages < capacity.numSCPMessages / GRANT_DIVISOR)
+    {
+        return false;
+    }
+
+    credits.numMessages = static_cast<uint32_t>(mUsed.mMessages);
+    credits.numBytes = static_cast<uint32_t>(mUsed.mBytes);
+    credits.numSCPMessages = static_cast<uint32_t>(mUsed.mSCPMessages);
+    mInbound.mMessages += mUsed.mMessages;
+    mInbound.mBytes += mUsed.mBytes;
+    mInbound.mSCPMessages += mUsed.mSCPMessages;
+    mUsed = Credits{};
+    return true;
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/SerializedMessage.h"
+#include "overlay/StellarXDR.h"
+
+namespace stellar
+{
+
+/*
+FlowControl
+Credits the two sides of a connection grant each other to send messages, in
+overlay version 11 and above.
+
+Once authenticated, each side grants the other a number of messages and of
+bytes it can send, plus a number of SCP messages reserved so that consensus
+keeps going while the connection is busy with transactions. Messages wait in
+the outbound queue until there are credits for them. Once the receiver
+processed a good part of what it granted, it grants as much again with a
+SEND_MORE message. A peer sending more than it was granted is dropped.
+
+Transactions count as processed once they went through the admission queue,
+so a peer cannot send transactions faster than they are admitted.
+
+Handshake, error and SEND_MORE messages (the CONTROL class of OutboundQueue)
+do not take credits.
+
+A message can be sent as long as some bytes are left, and may take more
+bytes than are left: messages larger than the byte credits still go through.
+*/
+class FlowControl
+{
+  public:
+    // credits granted when the connection is authenticated
+    static SendMore getCapacity();
+
+    // true if messages of this type take credits
+    static bool isFlowControlled(MessageType type);
+
+    // starts enforcing the credits granted to the peer, returns the credits
+    // to send it
+    SendMore start();
+
+    bool
+    isEnabled() const
+    {
+        return mEnabled;
+    }
+
+    // returns true, and takes the credits `msg` needs, if they are left
+    bool trySend(SerializedMessage const& msg);
+
+    // credits granted by the peer
+    void addCredits(SendMore const& credits);
+
+    // returns false if the peer had no credits left for this message
+    bool received(MessageType type, size_t size);
+
+    // the credits taken by a received message can be granted back
+    void processed(MessageType type, size_t size);
+
+    // returns true, and fills `credits`, once enough messages were received
+    // to grant more credits
+    bool getCreditsToGrant(SendMore& credits);
+
+  private:
+    struct Credits
+    {
+        int64_t mMessages{0};
+        int64_t mBytes{0};
+        int64_t mSCPMessages{0};
+    };
+
+    bool mEnabled{false};
+    // credits left to send to the peer
+    Credits mOutbound;
+    // credits left to the peer
+    Credits mInbound;
+    // credits used by the peer since the last grant
+    Credits mUsed;
+
+    static bool take(Credits& credits, MessageType type, size_t size);
+};
+}
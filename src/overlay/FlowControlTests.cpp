@@ -0,0 +1,223 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/Herder.h"
+#include "ledger/LedgerManager.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "overlay/FlowControl.h"
+#include "overlay/LoopbackPeer.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+using namespace stellar;
+using namespace stellar::txtest;
+
+TEST_CASE("flow control", "[overlay]")
+{
+    FlowControl flowControl;
+    auto capacity = FlowControl::getCapacity();
+
+    auto makeMessage = [](MessageType type) {
+        StellarMessage msg;
+        msg.type(type);
+        return std::make_shared<SerializedMessage const>(msg);
+    };
+    auto tx = makeMessage(TRANSACTION);
+    auto scp = makeMessage(SCP_MESSAGE);
+    auto sendMore = makeMessage(SEND_MORE);
+    auto txSize = tx->getBytes().size();
+
+    SECTION("nothing is limited before starting")
+    {
+        REQUIRE(!flowControl.isEnabled());
+        for (uint32 i = 0; i < capacity.numMessages + 1; i++)
+        {
+            REQUIRE(flowControl.trySend(*tx));
+            REQUIRE(flowControl.received(TRANSACTION, txSize));
+        }
+        SendMore credits;
+        REQUIRE(!flowControl.getCreditsToGrant(credits));
+    }
+
+    SECTION("sending")
+    {
+        flowControl.start();
+        REQUIRE(!flowControl.trySend(*tx));
+        REQUIRE(!flowControl.trySend(*scp));
+        REQUIRE(flowControl.trySend(*sendMore));
+
+        SendMore credits;
+        credits.numMessages = 2;
+        credits.numBytes = 1024;
+        credits.numSCPMessages = 1;
+        flowControl.addCredits(credits);
+
+        REQUIRE(flowControl.trySend(*tx));
+        REQUIRE(flowControl.trySend(*tx));
+        REQUIRE(!flowControl.trySend(*tx));
+        // SCP messages have their own credits
+        REQUIRE(flowControl.trySend(*scp));
+        REQUIRE(!flowControl.trySend(*scp));
+        REQUIRE(flowControl.trySend(*sendMore));
+    }
+
+    SECTION("a message may take more bytes than are left")
+    {
+        flowControl.start();
+        SendMore credits;
+        credits.numMessages = 10;
+        credits.numBytes = 1;
+        credits.numSCPMessages = 0;
+        flowControl.addCredits(credits);
+
+        REQUIRE(flowControl.trySend(*tx));
+        REQUIRE(!flowControl.trySend(*tx));
+    }
+
+    SECTION("receiving")
+    {
+        auto granted = flowControl.start();
+        REQUIRE(granted.numMessages == capacity.numMessages);
+        REQUIRE(granted.numSCPMessages == capacity.numSCPMessages);
+
+        SendMore credits;
+        REQUIRE(!flowControl.getCreditsToGrant(credits));
+
+        for (uint32 i = 0; i < capacity.numMessages; i++)
+        {
+            REQUIRE(flowControl.received(TRANSACTION, txSize));
+            flowControl.processed(TRANSACTION, txSize);
+        }
+        REQUIRE(!flowControl.received(TRANSACTION, txSize));
+        // SCP messages and control messages still go through
+        REQUIRE(flowControl.received(SCP_MESSAGE, 100));
+        flowControl.processed(SCP_MESSAGE, 100);
+        REQUIRE(flowControl.received(SEND_MORE, 12));
+        flowControl.processed(SEND_MORE, 12);
+
+        REQUIRE(flowControl.getCreditsToGrant(credits));
+        REQUIRE(credits.numMessages == capacity.numMessages);
+        REQUIRE(credits.numBytes == capacity.numMessages * txSize);
+        REQUIRE(credits.numSCPMessages == 1);
+        REQUIRE(!flowControl.getCreditsToGrant(credits));
+
+        // the credits granted can be used again
+        REQUIRE(flowControl.received(TRANSACTION, txSize));
+    }
+
+    SECTION("credits are granted back once messages are processed")
+    {
+        flowControl.start();
+        SendMore credits;
+        for (uint32 i = 0; i < capacity.numMessages; i++)
+        {
+            REQUIRE(flowControl.received(TRANSACTION, txSize));
+        }
+        REQUIRE(!flowControl.getCreditsToGrant(credits));
+
+        flowControl.processed(TRANSACTION, txSize);
+        REQUIRE(!flowControl.getCreditsToGrant(credits));
+        for (uint32 i = 1; i < capacity.numMessages; i++)
+        {
+            flowControl.processed(TRANSACTION, txSize);
+        }
+        REQUIRE(flowControl.getCreditsToGrant(credits));
+        REQUIRE(credits.numMessages == capacity.numMessages);
+    }
+
+    SECTION("credits are granted back before running out")
+    {
+        flowControl.start();
+        SendMore credits;
+        uint32 received = 0;
+        while (!flowControl.getCreditsToGrant(credits))
+        {
+            REQUIRE(flowControl.received(SCP_MESSAGE, 100));
+            flowControl.processed(SCP_MESSAGE, 100);
+            received++;
+        }
+        REQUIRE(received < capacity.numSCPMessages);
+        REQUIRE(credits.numSCPMessages == received);
+        REQUIRE(credits.numMessages == 0);
+    }
+}
+
+TEST_CASE("flow control between peers", "[overlay]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig(0));
+    auto a = createTestApplication(clock, getTestConfig(1));
+    auto cfgB = getTestConfig(2);
+    cfgB.OVERLAY_PROTOCOL_VERSION = FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL - 1;
+    auto b = createTestApplication(clock, cfgB);
+    for (auto node : {app, a, b})
+    {
+        node->start();
+    }
+
+    LoopbackPeerConnection connA(*a, *app);
+    LoopbackPeerConnection connB(*b, *app);
+    testutil::crankSome(clock);
+    REQUIRE(connA.getInitiator()->isFlowControlEnabled());
+    REQUIRE(!connB.getInitiator()->isFlowControlEnabled());
+
+    // more transactions than the quarter of the capacity after which
+    // credits are granted back
+    auto root = TestAccount::createRoot(*app);
+    auto amount = app->getLedgerManager().getMinBalance(0);
+    auto nbTxs = FlowControl::getCapacity().numMessages / 2;
+    auto send = [&](LoopbackPeer& peer) {
+        std::vector<TransactionFramePtr> txs;
+        for (uint32 i = 0; i < nbTxs; i++)
+        {
+            txs.emplace_back(root.tx(
+                {createAccount(SecretKey::random().getPublicKey(), amount)}));
+            peer.sendMessage(txs.back()->toStellarMessage());
+        }
+        auto const& last = txs.back()->getFullHash();
+        for (int i = 0; i < 100 && !app->getHerder().getTx(last); i++)
+        {
+            testutil::crankSome(clock);
+        }
+        REQUIRE(app->getHerder().getMaxSeqInPendingTxs(root) ==
+                txs.back()->getSeqNum());
+    };
+
+    auto sendMore = [](Application& node) {
+        return node.getMetrics()
+            .NewMeter({"overlay", "send", "send-more"}, "message")
+            .count();
+    };
+    auto recvSendMore = [](Application& node) {
+        return node.getMetrics()
+            .NewTimer({"overlay", "recv", "send-more"})
+            .count();
+    };
+    // credits granted when authenticating
+    auto grantedA = sendMore(*app);
+    REQUIRE(grantedA == 1);
+
+    SECTION("version 11 peer is granted more credits")
+    {
+        send(*connA.getInitiator());
+        REQUIRE(sendMore(*app) > grantedA);
+        REQUIRE(recvSendMore(*a) > 1);
+        REQUIRE(connA.getInitiator()->isAuthenticated());
+    }
+
+    SECTION("version 10 peer is not limited")
+    {
+        send(*connB.getInitiator());
+        REQUIRE(sendMore(*app) == grantedA);
+        REQUIRE(recvSendMore(*b) == 0);
+        REQUIRE(connB.getInitiator()->isAuthenticated());
+    }
+}
@@ -256,4 +256,54 @@ TEST_CASE("ItemFetcher fetches", "[overlay][ItemFetcher]")
         }
     }
 }
+
+TEST_CASE("ItemFetcher asks peers knowing the envelope in parallel",
+          "[overlay][ItemFetcher]")
+{
+    VirtualClock clock;
+    std::shared_ptr<ApplicationStub> app =
+        createTestApplication<ApplicationStub>(clock, getTestConfig(0));
+
+    std::vector<Peer::pointer> asked;
+    ItemFetcher itemFetcher(*app, [&](Peer::pointer peer, Hash hash) {
+        asked.push_back(peer);
+        peer->sendGetQuorumSet(hash);
+    });
+
+    auto other1 = createTestApplication(clock, getTestConfig(1));
+    auto other2 = createTestApplication(clock, getTestConfig(2));
+    auto other3 = createTestApplication(clock, getTestConfig(3));
+    LoopbackPeerConnection connection1(*app, *other1);
+    LoopbackPeerConnection connection2(*app, *other2);
+    LoopbackPeerConnection connection3(*app, *other3);
+    auto peer1 = connection1.getInitiator();
+    auto peer2 = connection2.getInitiator();
+    auto peer3 = connection3.getInitiator();
+    testutil::crankSome(clock);
+    REQUIRE(peer1->isAuthenticated());
+    REQUIRE(peer2->isAuthenticated());
+    REQUIRE(peer3->isAuthenticated());
+
+    // peer1 and peer2 sent the envelope that needs the item
+    auto envelope = makeEnvelope(0);
+    StellarMessage msg;
+    msg.type(SCP_MESSAGE);
+    msg.envelope() = envelope;
+    app->getOverlayManager().recvFloodedMsg(msg, peer1);
+    app->getOverlayManager().recvFloodedMsg(msg, peer2);
+
+    auto zero = sha256(ByteSlice("zero"));
+    itemFetcher.fetch(zero, envelope);
+
+    REQUIRE(asked.size() == 2);
+    REQUIRE(std::count(asked.begin(), asked.end(), peer1) == 1);
+    REQUIRE(std::count(asked.begin(), asked.end(), peer2) == 1);
+
+    // the item arriving cancels the requests
+    itemFetcher.recv(zero);
+    while (clock.crank(false) > 0)
+    {
+    }
+    REQUIRE(asked.size() == 2);
+}
 }
@@ -53,7 +53,39 @@ LoopbackPeer::getAuthCert()
 }
 
 void
-LoopbackPeer::sendMessage(xdr::msg_ptr&& msg)
+LoopbackPeer::queueMessage(SerializedMessagePtr msg)
+{
+    if (mRemote.expired())
+    {
+        drop();
+        return;
+    }
+
+    // messages taking credits are sent in order once there are credits for
+    // them, the others right away
+    if (FlowControl::isFlowControlled(msg->getType()) &&
+        (!mWaitingForCredits.empty() || !mFlowControl.trySend(*msg)))
+    {
+        mWaitingForCredits.emplace_back(std::move(msg));
+        return;
+    }
+    sendMessageWithCredits(std::move(msg));
+}
+
+void
+LoopbackPeer::creditsGranted()
+{
+    while (!mWaitingForCredits.empty() &&
+           mFlowControl.trySend(*mWaitingForCredits.front()))
+    {
+        auto msg = std::move(mWaitingForCredits.front());
+        mWaitingForCredits.pop_front();
+        sendMessageWithCredits(std::move(msg));
+    }
+}
+
+void
+LoopbackPeer::sendMessageWithCredits(SerializedMessagePtr msg)
 {
     if (mRemote.expired())
     {
@@ -69,7 +101,8 @@ LoopbackPeer::sendMessage(xdr::msg_ptr&& msg)
     }
 
     // CLOG(TRACE, "Overlay") << "LoopbackPeer queueing message";
-    mOutQueue.emplace_back(std::move(msg));
+    // the frame is flattened as the queued bytes can be damaged in place
+    mOutQueue.emplace_back(authenticate(std::move(msg)).toMsg());
     // Possibly flush some queued messages if queue's full.
     while (mOutQueue.size() > mMaxQueueDepth && !mCorked)
     {
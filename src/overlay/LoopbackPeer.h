@@ -27,6 +27,8 @@ class LoopbackPeer : public Peer
     std::weak_ptr<LoopbackPeer> mRemote;
     std::deque<xdr::msg_ptr> mOutQueue; // sending queue
     std::queue<xdr::msg_ptr> mInQueue;  // receiving queue
+    // messages queued while the remote gave no credits for them
+    std::deque<SerializedMessagePtr> mWaitingForCredits;
 
     bool mCorked{false};
     size_t mMaxQueueDepth{0};
@@ -52,7 +54,9 @@ class LoopbackPeer : public Peer
 
     Stats mStats;
 
-    void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void queueMessage(SerializedMessagePtr msg) override;
+    void creditsGranted() override;
+    void sendMessageWithCredits(SerializedMessagePtr msg);
     PeerBareAddress makeAddress(int remoteListeningPort) const override;
     AuthCert getAuthCert() override;
 
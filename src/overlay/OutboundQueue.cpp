@@ -0,0 +1,181 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/OutboundQueue.h"
+#include "main/Application.h"
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace stellar
+{
+
+OutboundQueue::Class
+OutboundQueue::getClass(MessageType type)
+{
+    switch (type)
+    {
+    case HELLO:
+    case AUTH:
+    case ERROR_MSG:
+    case SEND_MORE:
+        return CONTROL;
+    case GET_TX_SET:
+    case TX_SET:
+    case GET_COMPACT_TX_SET:
+    case COMPACT_TX_SET:
+    case GET_SCP_QUORUMSET:
+    case SCP_QUORUMSET:
+    case DONT_HAVE:
+        return FETCH;
+    case TRANSACTION:
+    case TRANSACTIONS:
+    case FLOOD_ADVERT:
+    case FLOOD_DEMAND:
+        return TRANSACTION;
+    case GET_PEERS:
+    case PEERS:
+        return GOSSIP;
+    default:
+        return SCP;
+    }
+}
+
+OutboundQueue::Limits
+OutboundQueue::getLimits(Class c)
+{
+    switch (c)
+    {
+    case CONTROL:
+        return {100, 1024 * 1024};
+    case SCP:
+        return {2000, 4 * 1024 * 1024};
+    case FETCH:
+        return {200, 32 * 1024 * 1024};
+    case TRANSACTION:
+        return {5000, 4 * 1024 * 1024};
+    default:
+        return {10, 1024 * 1024};
+    }
+}
+
+OutboundQueue::OutboundQueue(Application& app)
+    : mMemory(
+          app.getMetrics().NewCounter({"overlay", "memory", "outbound-queue"}))
+    , mShedTransaction(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "shed-transaction"}, "message"))
+    , mShedGossip(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "shed-gossip"}, "message"))
+    , mOverflow(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "overflow"}, "message"))
+{
+}
+
+OutboundQueue::~OutboundQueue()
+{
+    for (auto const& q : mQueues)
+    {
+        mMemory.dec(q.mBytes);
+    }
+}
+
+bool
+OutboundQueue::push(SerializedMessagePtr msg)
+{
+    auto c = getClass(msg->getType());
+    auto limits = getLimits(c);
+    auto& q = mQueues[c];
+    auto bytes = msg->getBytes().size();
+
+    auto fits = [&]() {
+        return q.mMessages.empty() || (q.mMessages.size() < limits.mMessages &&
+                                       q.mBytes + bytes <= limits.mBytes);
+    };
+
+    if (!fits())
+    {
+        if (c != TRANSACTION && c != GOSSIP)
+        {
+            mOverflow.Mark();
+            return false;
+        }
+        // drop the oldest messages, the least likely to still be useful
+        while (!fits())
+        {
+            popFrom(q);
+            (c == TRANSACTION ? mShedTransaction : mShedGossip).Mark();
+        }
+    }
+
+    q.mMessages.emplace_back(std::move(msg));
+    q.mBytes += bytes;
+    mMemory.inc(bytes);
+    mSize++;
+    return true;
+}
+
+SerializedMessagePtr const&
+OutboundQueue::front() const
+{
+    for (auto const& q : mQueues)
+    {
+        if (!q.mMessages.empty())
+        {
+            return q.mMessages.front();
+        }
+    }
+    throw std::runtime_error("front() on an empty outbound queue");
+}
+
+void
+OutboundQueue::pop()
+{
+    for (auto& q : mQueues)
+    {
+        if (!q.mMessages.empty())
+        {
+            popFrom(q);
+            return;
+        }
+    }
+    throw std::runtime_error("pop() on an empty outbound queue");
+}
+
+SerializedMessagePtr
+OutboundQueue::popFirst(
+    std::function<bool(SerializedMessage const&)> const& accept)
+{
+    for (auto& q : mQueues)
+    {
+        if (!q.mMessages.empty() && accept(*q.mMessages.front()))
+        {
+            auto msg = q.mMessages.front();
+            popFrom(q);
+            return msg;
+        }
+    }
+    return nullptr;
+}
+
+size_t
+OutboundQueue::size(Class c) const
+{
+    return mQueues[c].mMessages.size();
+}
+
+void
+OutboundQueue::popFrom(Queue& q)
+{
+    assert(!q.mMessages.empty());
+    auto bytes = q.mMessages.front()->getBytes().size();
+    q.mMessages.pop_front();
+    q.mBytes -= bytes;
+    mMemory.dec(bytes);
+    mSize--;
+}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/SerializedMessage.h"
+#include "util/NonCopyable.h"
+
+#include <array>
+#include <deque>
+#include <functional>
+
+namespace medida
+{
+class Counter;
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+
+/*
+OutboundQueue
+Messages waiting to be written to a peer, split in classes by message type:
+
+  * CONTROL: the handshake, errors and flow control messages;
+  * SCP: consensus messages;
+  * FETCH: requests and replies for tx sets and quorum sets;
+  * TRANSACTION: flooded transactions, and their adverts and demands;
+  * GOSSIP: peer lists.
+
+Messages are popped by strict priority in that order, and in the order they
+were pushed within a class, so a backlog of transactions never delays an SCP
+message.
+
+Each class is bounded in messages and bytes (a single message is always
+accepted by an empty class). When a peer falls behind, the oldest
+transactions and peer lists are shed to make room; the other classes cannot
+lose messages without breaking the protocol, so overflowing them is
+reported to the caller, who is expected to drop the peer.
+*/
+class OutboundQueue : NonMovableOrCopyable
+{
+  public:
+    enum Class
+    {
+        CONTROL = 0,
+        SCP,
+        FETCH,
+        TRANSACTION,
+        GOSSIP,
+        CLASS_COUNT
+    };
+
+    struct Limits
+    {
+        size_t mMessages;
+        size_t mBytes;
+    };
+
+    static Class getClass(MessageType type);
+    static Limits getLimits(Class c);
+
+    explicit OutboundQueue(Application& app);
+    ~OutboundQueue();
+
+    // returns false if the message does not fit and its class cannot shed
+    // messages; the message is not queued then
+    bool push(SerializedMessagePtr msg);
+
+    // highest priority message, the queue must not be empty
+    SerializedMessagePtr const& front() const;
+    void pop();
+
+    // pops the highest priority message `accept` returns true for, looking
+    // only at the oldest message of each class (so messages of a class stay
+    // in order); returns null if no message was accepted
+    SerializedMessagePtr
+    popFirst(std::function<bool(SerializedMessage const&)> const& accept);
+
+    bool
+    empty() const
+    {
+        return mSize == 0;
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+
+    size_t size(Class c) const;
+
+  private:
+    struct Queue
+    {
+        std::deque<SerializedMessagePtr> mMessages;
+        size_t mBytes{0};
+    };
+
+    std::array<Queue, CLASS_COUNT> mQueues;
+    size_t mSize{0};
+
+    medida::Counter& mMemory;
+    medida::Meter& mShedTransaction;
+    medida::Meter& mShedGossip;
+    medida::Meter& mOverflow;
+
+    void popFrom(Queue& q);
+};
+}
@@ -0,0 +1,95 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "overlay/OutboundQueue.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "util/Timer.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+using namespace stellar;
+
+TEST_CASE("outbound queue", "[overlay]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+
+    OutboundQueue queue(*app);
+
+    auto makeMessage = [](MessageType type, uint32 tag) {
+        StellarMessage msg;
+        msg.type(type);
+        switch (type)
+        {
+        case TRANSACTION:
+            msg.transaction().tx.seqNum = tag;
+            break;
+        case SCP_MESSAGE:
+            msg.envelope().statement.slotIndex = tag;
+            break;
+        case GET_TX_SET:
+            msg.txSetHash()[0] = static_cast<uint8_t>(tag);
+            break;
+        default:
+            break;
+        }
+        return std::make_shared<SerializedMessage const>(msg);
+    };
+
+    SECTION("strict priority, in order within a class")
+    {
+        auto tx1 = makeMessage(TRANSACTION, 1);
+        auto peers = makeMessage(GET_PEERS, 0);
+        auto fetch = makeMessage(GET_TX_SET, 1);
+        auto tx2 = makeMessage(TRANSACTION, 2);
+        auto scp = makeMessage(SCP_MESSAGE, 1);
+        for (auto const& m : {tx1, peers, fetch, tx2, scp})
+        {
+            REQUIRE(queue.push(m));
+        }
+        REQUIRE(queue.size() == 5);
+        REQUIRE(queue.size(OutboundQueue::TRANSACTION) == 2);
+
+        std::vector<SerializedMessagePtr> popped;
+        while (!queue.empty())
+        {
+            popped.emplace_back(queue.front());
+            queue.pop();
+        }
+        REQUIRE(popped ==
+                std::vector<SerializedMessagePtr>{scp, fetch, tx1, tx2, peers});
+    }
+
+    SECTION("transactions are shed oldest first")
+    {
+        auto& shed = app->getMetrics().NewMeter(
+            {"overlay", "outbound-queue", "shed-transaction"}, "message");
+        auto limit = OutboundQueue::getLimits(OutboundQueue::TRANSACTION);
+        for (uint32 i = 0; i < limit.mMessages + 2; i++)
+        {
+            REQUIRE(queue.push(makeMessage(TRANSACTION, i)));
+        }
+        REQUIRE(queue.size() == limit.mMessages);
+        REQUIRE(shed.count() == 2);
+        REQUIRE(queue.front()->getBytes() ==
+                makeMessage(TRANSACTION, 2)->getBytes());
+    }
+
+    SECTION("scp overflow is reported")
+    {
+        auto limit = OutboundQueue::getLimits(OutboundQueue::SCP);
+        for (uint32 i = 0; i < limit.mMessages; i++)
+        {
+            REQUIRE(queue.push(makeMessage(SCP_MESSAGE, i)));
+        }
+        REQUIRE(!queue.push(makeMessage(SCP_MESSAGE, 0)));
+        REQUIRE(queue.size() == limit.mMessages);
+        // other classes are not affected
+        REQUIRE(queue.push(makeMessage(GET_TX_SET, 0)));
+    }
+}
@@ -76,6 +76,23 @@ class OverlayManager
     virtual void recvFloodedMsg(StellarMessage const& msg,
                                 Peer::pointer peer) = 0;
 
+    // Same as above, for a message the FloodGate already knows, identified by
+    // the sha256 of its encoding.
+    virtual void recvFloodedMsg(Hash const& index, Peer::pointer peer) = 0;
+
+    // Returns true if the FloodGate has a record of the message with the
+    // given hash. Unlike the rest of the OverlayManager, this can be called
+    // from any thread.
+    virtual bool isFloodedMsgKnown(Hash const& index) = 0;
+
+    // Records that a peer advertised a transaction, returns true if it should
+    // be demanded from that peer, see FloodGate::recvTxAdvert.
+    virtual bool recvTxAdvert(Hash const& txHash, Peer::pointer peer) = 0;
+
+    // Records that a transaction failed validation, so that adverts for it
+    // are ignored, see FloodGate::rejectTx.
+    virtual void rejectTx(Hash const& txHash) = 0;
+
     // Return a list of random peers from the set of authenticated peers.
     virtual std::vector<Peer::pointer> getRandomAuthenticatedPeers() = 0;
 
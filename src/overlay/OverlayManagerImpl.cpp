@@ -532,6 +532,31 @@ OverlayManagerImpl::recvFloodedMsg(StellarMessage const& msg,
     mFloodGate.addRecord(msg, peer);
 }
 
+void
+OverlayManagerImpl::recvFloodedMsg(Hash const& index, Peer::pointer peer)
+{
+    mMessagesReceived.Mark();
+    mFloodGate.addPeer(index, peer);
+}
+
+bool
+OverlayManagerImpl::isFloodedMsgKnown(Hash const& index)
+{
+    return mFloodGate.isKnown(index);
+}
+
+bool
+OverlayManagerImpl::recvTxAdvert(Hash const& txHash, Peer::pointer peer)
+{
+    return mFloodGate.recvTxAdvert(txHash, peer);
+}
+
+void
+OverlayManagerImpl::rejectTx(Hash const& txHash)
+{
+    mFloodGate.rejectTx(txHash);
+}
+
 void
 OverlayManagerImpl::broadcastMessage(StellarMessage const& msg, bool force)
 {
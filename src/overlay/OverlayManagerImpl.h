@@ -71,6 +71,10 @@ class OverlayManagerImpl : public OverlayManager
 
     void ledgerClosed(uint32_t lastClosedledgerSeq) override;
     void recvFloodedMsg(StellarMessage const& msg, Peer::pointer peer) override;
+    void recvFloodedMsg(Hash const& index, Peer::pointer peer) override;
+    bool isFloodedMsgKnown(Hash const& index) override;
+    bool recvTxAdvert(Hash const& txHash, Peer::pointer peer) override;
+    void rejectTx(Hash const& txHash) override;
     void broadcastMessage(StellarMessage const& msg,
                           bool force = false) override;
     void connectTo(std::string const& addr) override;
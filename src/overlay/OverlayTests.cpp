@@ -4,6 +4,7 @@
 
 #include "BanManager.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
@@ -17,11 +18,13 @@
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
+#include "util/XDROperators.h"
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 #include "util/format.h"
+#include "xdrpp/marshal.h"
 #include <numeric>
 
 using namespace stellar;
@@ -507,3 +510,32 @@ TEST_CASE("preferred peers always connect", "[overlay]")
     REQUIRE(numberOfAppConnections(*simulation->getNode(vNode2NodeID)) == 1);
     REQUIRE(numberOfAppConnections(*simulation->getNode(vNode3NodeID)) == 1);
 }
+
+TEST_CASE("authenticated frame matches message encoding", "[overlay]")
+{
+    StellarMessage msg;
+    msg.type(GET_SCP_STATE);
+    msg.getSCPLedgerSeq() = 42;
+    auto serialized = std::make_shared<SerializedMessage const>(msg);
+    REQUIRE(serialized->getHash() == sha256(xdr::xdr_to_opaque(msg)));
+
+    HmacSha256Key key;
+    key.key[0] = 1;
+    uint64 sequence = 0x0102030405060708;
+    auto mac = hmacSha256(key, xdr::xdr_to_opaque(sequence),
+                          serialized->getBytes());
+    REQUIRE(mac == hmacSha256(key, xdr::xdr_to_opaque(sequence, msg)));
+
+    AuthenticatedMessage amsg;
+    amsg.v0().sequence = sequence;
+    amsg.v0().message = msg;
+    amsg.v0().mac = mac;
+    auto expected = xdr::xdr_to_msg(amsg);
+
+    AuthenticatedFrame frame(serialized, sequence, mac);
+    auto actual = frame.toMsg();
+    REQUIRE(frame.size() == expected->raw_size());
+    REQUIRE(actual->raw_size() == expected->raw_size());
+    REQUIRE(std::equal(actual->raw_data(), actual->end(),
+                       expected->raw_data()));
+}
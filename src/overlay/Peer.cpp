@@ -29,7 +29,10 @@
 #include "xdrpp/marshal.h"
 
 #include <soci.h>
+#include <sodium.h>
 #include <time.h>
+#include <unordered_map>
+#include <unordered_set>
 
 // LATER: need to add some way of docking peers that are misbehaving by sending
 // you bad data
@@ -40,6 +43,17 @@ namespace stellar
 using namespace std;
 using namespace soci;
 
+// adverts are held that long to be sent in batches
+static std::chrono::milliseconds const TX_ADVERT_PERIOD(100);
+
+// fetch latency of a peer that did not answer any request yet
+static std::chrono::milliseconds const INITIAL_FETCH_LATENCY(500);
+// requests not answered for that long are counted as answered after that
+// long, a slow peer is not better than a peer that does not answer
+static std::chrono::milliseconds const MAX_FETCH_LATENCY(1500);
+// compact tx sets asked that long ago are not waited for anymore
+static std::chrono::seconds const COMPACT_TX_SET_REQUEST_TIMEOUT(30);
+
 medida::Meter&
 Peer::getByteReadMeter(Application& app)
 {
@@ -58,6 +72,8 @@ Peer::Peer(Application& app, PeerRole role)
     , mState(role == WE_CALLED_REMOTE ? CONNECTING : CONNECTED)
     , mRemoteOverlayVersion(0)
     , mIdleTimer(app)
+    , mTxAdvertTimer(app)
+    , mFetchLatency(INITIAL_FETCH_LATENCY)
     , mLastRead(app.getClock().now())
     , mLastWrite(app.getClock().now())
 
@@ -95,6 +111,18 @@ Peer::Peer(Application& app, PeerRole role)
           app.getMetrics().NewTimer({"overlay", "recv", "scp-message"}))
     , mRecvGetSCPStateTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "get-scp-state"}))
+    , mRecvFloodAdvertTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-advert"}))
+    , mRecvFloodDemandTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-demand"}))
+    , mRecvTransactionsTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "transactions"}))
+    , mRecvGetCompactTxSetTimer(app.getMetrics().NewTimer(
+          {"overlay", "recv", "get-compact-txset"}))
+    , mRecvCompactTxSetTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "compact-txset"}))
+    , mRecvSendMoreTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "send-more"}))
 
     , mRecvSCPPrepareTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "scp-prepare"}))
@@ -131,6 +159,24 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "send", "scp-message"}, "message"))
     , mSendGetSCPStateMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "get-scp-state"}, "message"))
+    , mSendFloodAdvertMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-advert"}, "message"))
+    , mSendFloodDemandMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-demand"}, "message"))
+    , mSendTransactionsMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "transactions"}, "message"))
+    , mSendGetCompactTxSetMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "get-compact-txset"}, "message"))
+    , mSendCompactTxSetMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "compact-txset"}, "message"))
+    , mSendSendMoreMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "send-more"}, "message"))
+    , mCompactTxSetCompleteMeter(app.getMetrics().NewMeter(
+          {"overlay", "compact-txset", "complete"}, "txset"))
+    , mCompactTxSetMissingMeter(app.getMetrics().NewMeter(
+          {"overlay", "compact-txset", "missing"}, "transaction"))
+    , mCompactTxSetFallbackMeter(app.getMetrics().NewMeter(
+          {"overlay", "compact-txset", "fallback"}, "txset"))
     , mDropInConnectHandlerMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "connect-handler"}, "drop"))
     , mDropInRecvMessageDecodeMeter(app.getMetrics().NewMeter(
@@ -141,6 +187,8 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "drop", "recv-message-mac"}, "drop"))
     , mDropInRecvMessageUnauthMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "recv-message-unauth"}, "drop"))
+    , mDropInRecvMessageFlowControlMeter(app.getMetrics().NewMeter(
+          {"overlay", "drop", "recv-message-flow-control"}, "drop"))
     , mDropInRecvHelloUnexpectedMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "recv-hello-unexpected"}, "drop"))
     , mDropInRecvHelloVersionMeter(app.getMetrics().NewMeter(
@@ -165,6 +213,8 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "drop", "recv-auth-invalid-peer"}, "drop"))
     , mDropInRecvErrorMeter(
           app.getMetrics().NewMeter({"overlay", "drop", "recv-error"}, "drop"))
+    , mRecvDuplicateMeter(app.getMetrics().NewMeter(
+          {"overlay", "recv", "duplicate"}, "message"))
 {
     auto bytes = randomBytes(mSendNonce.size());
     std::copy(bytes.begin(), bytes.end(), mSendNonce.begin());
@@ -333,10 +383,41 @@ Peer::sendSCPQuorumSet(SCPQuorumSetPtr qSet)
 void
 Peer::sendGetTxSet(uint256 const& setID)
 {
+    noteFetchRequest(setID);
+    if (isCompactTxSetEnabled())
+    {
+        sendGetCompactTxSet(setID);
+        return;
+    }
+
     StellarMessage newMsg;
     newMsg.type(GET_TX_SET);
     newMsg.txSetHash() = setID;
+    sendMessage(newMsg);
+}
+
+void
+Peer::sendGetCompactTxSet(Hash const& setID, xdr::xvector<ShortTxID> missing)
+{
+    auto now = mApp.getClock().now();
+    for (auto it = mCompactTxSetRequests.begin();
+         it != mCompactTxSetRequests.end();)
+    {
+        if (now - it->second >= COMPACT_TX_SET_REQUEST_TIMEOUT)
+        {
+            it = mCompactTxSetRequests.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    mCompactTxSetRequests[setID] = now;
 
+    StellarMessage newMsg;
+    newMsg.type(GET_COMPACT_TX_SET);
+    newMsg.getCompactTxSet().txSetHash = setID;
+    newMsg.getCompactTxSet().missingTxs = std::move(missing);
     sendMessage(newMsg);
 }
 void
@@ -349,6 +430,7 @@ Peer::sendGetQuorumSet(uint256 const& setID)
     newMsg.type(GET_SCP_QUORUMSET);
     newMsg.qSetHash() = setID;
 
+    noteFetchRequest(setID);
     sendMessage(newMsg);
 }
 
@@ -451,6 +533,18 @@ msgSummary(StellarMessage const& msg)
         }
     case GET_SCP_STATE:
         return "GET_SCP_STATE";
+    case FLOOD_ADVERT:
+        return "FLOODADVERT";
+    case FLOOD_DEMAND:
+        return "FLOODDEMAND";
+    case TRANSACTIONS:
+        return "TRANSACTIONS";
+    case GET_COMPACT_TX_SET:
+        return "GETCOMPACTTXSET";
+    case COMPACT_TX_SET:
+        return "COMPACTTXSET";
+    case SEND_MORE:
+        return "SENDMORE";
     }
     return "UNKNOWN";
 }
@@ -466,7 +560,13 @@ Peer::sendMessage(StellarMessage const& msg)
             << ") send: " << msgSummary(msg)
             << " to : " << mApp.getConfig().toShortString(mPeerID);
 
-    switch (msg.type())
+    sendMessage(std::make_shared<SerializedMessage const>(msg));
+}
+
+void
+Peer::sendMessage(SerializedMessagePtr msg)
+{
+    switch (msg->getType())
     {
     case ERROR_MSG:
         mSendErrorMeter.Mark();
@@ -507,19 +607,44 @@ Peer::sendMessage(StellarMessage const& msg)
     case GET_SCP_STATE:
         mSendGetSCPStateMeter.Mark();
         break;
+    case FLOOD_ADVERT:
+        mSendFloodAdvertMeter.Mark();
+        break;
+    case FLOOD_DEMAND:
+        mSendFloodDemandMeter.Mark();
+        break;
+    case TRANSACTIONS:
+        mSendTransactionsMeter.Mark();
+        break;
+    case GET_COMPACT_TX_SET:
+        mSendGetCompactTxSetMeter.Mark();
+        break;
+    case COMPACT_TX_SET:
+        mSendCompactTxSetMeter.Mark();
+        break;
+    case SEND_MORE:
+        mSendSendMoreMeter.Mark();
+        break;
     };
 
-    AuthenticatedMessage amsg;
-    amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
+    queueMessage(std::move(msg));
+}
+
+AuthenticatedFrame
+Peer::authenticate(SerializedMessagePtr msg)
+{
+    // the MAC covers the encoding of (sequence, message), which is the
+    // encoded sequence number followed by the shared message body
+    uint64 sequence = 0;
+    HmacSha256Mac mac;
+    if (msg->getType() != HELLO && msg->getType() != ERROR_MSG)
     {
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
+        sequence = mSendMacSeq;
+        mac = hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq),
+                         msg->getBytes());
         ++mSendMacSeq;
     }
-    xdr::msg_ptr xdrBytes(xdr::xdr_to_msg(amsg));
-    this->sendMessage(std::move(xdrBytes));
+    return AuthenticatedFrame(std::move(msg), sequence, mac);
 }
 
 void
@@ -567,7 +692,7 @@ Peer::shouldAbort() const
 }
 
 void
-Peer::recvMessage(AuthenticatedMessage const& msg)
+Peer::recvMessage(AuthenticatedMessage const& msg, bool macVerified)
 {
     if (shouldAbort())
     {
@@ -576,16 +701,13 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
 
     if (mState >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
     {
-        if (msg.v0().sequence != mRecvMacSeq)
+        if (!checkRecvSequence(msg.v0().sequence))
         {
-            CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
-            mDropInRecvMessageSeqMeter.Mark();
-            ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected auth sequence");
             return;
         }
 
-        if (!hmacSha256Verify(
+        if (!macVerified &&
+            !hmacSha256Verify(
                 msg.v0().mac, mRecvMacKey,
                 xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
         {
@@ -597,7 +719,99 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
         }
         ++mRecvMacSeq;
     }
-    recvMessage(msg.v0().message);
+
+    auto const& message = msg.v0().message;
+    size_t size = 0;
+    if (mFlowControl.isEnabled() &&
+        FlowControl::isFlowControlled(message.type()))
+    {
+        size = xdr::xdr_size(message);
+        if (!checkRecvCredits(message.type(), size))
+        {
+            return;
+        }
+    }
+    recvMessage(message);
+    // transactions are processed once admitted, see recvTransaction
+    if (message.type() != TRANSACTION && message.type() != TRANSACTIONS)
+    {
+        messageProcessed(message.type(), size);
+    }
+}
+
+bool
+Peer::checkRecvSequence(uint64 sequence)
+{
+    if (sequence != mRecvMacSeq)
+    {
+        CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
+        mDropInRecvMessageSeqMeter.Mark();
+        ++mRecvMacSeq;
+        drop(ERR_AUTH, "unexpected auth sequence");
+        return false;
+    }
+    return true;
+}
+
+bool
+Peer::checkRecvCredits(MessageType type, size_t size)
+{
+    if (!mFlowControl.received(type, size))
+    {
+        CLOG(ERROR, "Overlay") << "Message sent without credits";
+        mDropInRecvMessageFlowControlMeter.Mark();
+        drop(ERR_LOAD, "message sent without credits");
+        return false;
+    }
+    return true;
+}
+
+void
+Peer::maybeSendMore()
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    StellarMessage msg;
+    msg.type(SEND_MORE);
+    if (mFlowControl.getCreditsToGrant(msg.sendMore()))
+    {
+        sendMessage(msg);
+    }
+}
+
+void
+Peer::messageProcessed(MessageType type, size_t size)
+{
+    mFlowControl.processed(type, size);
+    maybeSendMore();
+}
+
+void
+Peer::recvDuplicateMessage(uint64 sequence, Hash const& index, size_t size)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    assert(isAuthenticated());
+    if (!checkRecvSequence(sequence))
+    {
+        return;
+    }
+    ++mRecvMacSeq;
+
+    if (mFlowControl.isEnabled() && !checkRecvCredits(TRANSACTION, size))
+    {
+        return;
+    }
+
+    mRecvDuplicateMeter.Mark();
+    mApp.getOverlayManager().recvFloodedMsg(index, shared_from_this());
+    messageProcessed(TRANSACTION, size);
 }
 
 void
@@ -721,12 +935,59 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
         recvGetSCPState(stellarMsg);
     }
     break;
+
+    case FLOOD_ADVERT:
+    {
+        auto t = mRecvFloodAdvertTimer.TimeScope();
+        recvFloodAdvert(stellarMsg);
+    }
+    break;
+
+    case FLOOD_DEMAND:
+    {
+        auto t = mRecvFloodDemandTimer.TimeScope();
+        recvFloodDemand(stellarMsg);
+    }
+    break;
+
+    case TRANSACTIONS:
+    {
+        auto t = mRecvTransactionsTimer.TimeScope();
+        recvTransactions(stellarMsg);
+    }
+    break;
+
+    case GET_COMPACT_TX_SET:
+    {
+        auto t = mRecvGetCompactTxSetTimer.TimeScope();
+        recvGetCompactTxSet(stellarMsg);
+    }
+    break;
+
+    case COMPACT_TX_SET:
+    {
+        auto t = mRecvCompactTxSetTimer.TimeScope();
+        recvCompactTxSet(stellarMsg);
+    }
+    break;
+
+    case SEND_MORE:
+    {
+        auto t = mRecvSendMoreTimer.TimeScope();
+        recvSendMore(stellarMsg);
+    }
+    break;
     }
 }
 
 void
 Peer::recvDontHave(StellarMessage const& msg)
 {
+    noteFetchReply(msg.dontHave().reqHash);
+    if (msg.dontHave().type == TX_SET)
+    {
+        mCompactTxSetRequests.erase(msg.dontHave().reqHash);
+    }
     mApp.getHerder().peerDoesntHave(msg.dontHave().type, msg.dontHave().reqHash,
                                     shared_from_this());
 }
@@ -753,33 +1014,259 @@ void
 Peer::recvTxSet(StellarMessage const& msg)
 {
     TxSetFrame frame(mApp.getNetworkID(), msg.txSet());
+    noteFetchReply(frame.getContentsHash());
     mApp.getHerder().recvTxSet(frame.getContentsHash(), frame);
 }
 
+ShortTxID
+Peer::getShortTxID(Hash const& txSetHash, Hash const& txHash)
+{
+    // SipHash-2-4 keyed by the tx set hash, so that no one can pick
+    // transactions whose ids collide in every set
+    static_assert(crypto_shorthash_KEYBYTES <= sizeof(txSetHash),
+                  "tx set hash too short for a short hash key");
+    unsigned char out[crypto_shorthash_BYTES];
+    crypto_shorthash(out, txHash.data(), txHash.size(), txSetHash.data());
+    ShortTxID res = 0;
+    for (size_t i = sizeof(out); i > 0; i--)
+    {
+        res = (res << 8) | out[i - 1];
+    }
+    return res;
+}
+
+void
+Peer::recvGetCompactTxSet(StellarMessage const& msg)
+{
+    auto const& req = msg.getCompactTxSet();
+    auto txSet = mApp.getHerder().getTxSet(req.txSetHash);
+    if (!txSet)
+    {
+        sendDontHave(TX_SET, req.txSetHash);
+        return;
+    }
+
+    std::unordered_set<ShortTxID> missing(req.missingTxs.begin(),
+                                          req.missingTxs.end());
+
+    StellarMessage newMsg;
+    newMsg.type(COMPACT_TX_SET);
+    auto& compact = newMsg.compactTxSet();
+    compact.txSetHash = req.txSetHash;
+    compact.previousLedgerHash = txSet->previousLedgerHash();
+
+    // computing the hash puts the transactions in hash order, the order the
+    // receiver rebuilds the set in
+    txSet->getContentsHash();
+    compact.txs.reserve(txSet->mTransactions.size());
+    for (auto const& tx : txSet->mTransactions)
+    {
+        auto id = getShortTxID(req.txSetHash, tx->getFullHash());
+        compact.txs.emplace_back(id);
+        if (missing.find(id) != missing.end())
+        {
+            compact.missingTxs.emplace_back(tx->getEnvelope());
+        }
+    }
+
+    sendMessage(newMsg);
+}
+
+void
+Peer::recvCompactTxSet(StellarMessage const& msg)
+{
+    auto const& compact = msg.compactTxSet();
+    if (mCompactTxSetRequests.erase(compact.txSetHash) == 0)
+    {
+        CLOG(DEBUG, "Overlay")
+            << "Ignoring unrequested compact tx set "
+            << hexAbbrev(compact.txSetHash) << " from " << toString();
+        return;
+    }
+    noteFetchReply(compact.txSetHash);
+
+    // the transactions the set can be rebuilt from: the pending ones, and the
+    // ones the peer sent because we asked for them
+    std::unordered_map<ShortTxID, TransactionFramePtr> known;
+    for (auto const& tx : mApp.getHerder().getPendingTxs())
+    {
+        known[getShortTxID(compact.txSetHash, tx->getFullHash())] = tx;
+    }
+    for (auto const& env : compact.missingTxs)
+    {
+        auto tx = TransactionFrame::makeTransactionFromWire(
+            mApp.getNetworkID(), env);
+        if (tx)
+        {
+            known[getShortTxID(compact.txSetHash, tx->getFullHash())] = tx;
+        }
+    }
+
+    TxSetFrame frame(compact.previousLedgerHash);
+    xdr::xvector<ShortTxID> missing;
+    for (auto id : compact.txs)
+    {
+        auto it = known.find(id);
+        if (it == known.end())
+        {
+            missing.emplace_back(id);
+        }
+        else
+        {
+            frame.add(it->second);
+        }
+    }
+
+    if (missing.empty() && frame.getContentsHash() == compact.txSetHash)
+    {
+        mCompactTxSetCompleteMeter.Mark();
+        mApp.getHerder().recvTxSet(compact.txSetHash, frame);
+        return;
+    }
+
+    if (!missing.empty() && compact.missingTxs.empty())
+    {
+        // first answer, ask for what we do not have
+        mCompactTxSetMissingMeter.Mark(missing.size());
+        sendGetCompactTxSet(compact.txSetHash, std::move(missing));
+        return;
+    }
+
+    // short ids matched the wrong transactions, or the peer did not send
+    // the ones we asked for: get the whole set
+    mCompactTxSetFallbackMeter.Mark();
+    StellarMessage newMsg;
+    newMsg.type(GET_TX_SET);
+    newMsg.txSetHash() = compact.txSetHash;
+    sendMessage(newMsg);
+}
+
+static void
+floodTransaction(Application& app, std::weak_ptr<Peer> const& from,
+                 StellarMessage const& msg,
+                 Herder::TransactionSubmitStatus recvRes)
+{
+    if (recvRes == Herder::TX_STATUS_PENDING ||
+        recvRes == Herder::TX_STATUS_DUPLICATE)
+    {
+        // record that this peer sent us this transaction
+        auto self = from.lock();
+        if (self)
+        {
+            app.getOverlayManager().recvFloodedMsg(msg, self);
+        }
+
+        if (recvRes == Herder::TX_STATUS_PENDING)
+        {
+            // if it's a new transaction, broadcast it
+            app.getOverlayManager().broadcastMessage(msg);
+        }
+    }
+}
+
+// remembers transactions that failed validation so that they are not
+// demanded again; those that could become valid later are not recorded
+static void
+rejectTransaction(Application& app, TransactionFramePtr const& tx,
+                  Herder::TransactionSubmitStatus recvRes)
+{
+    if (recvRes != Herder::TX_STATUS_ERROR)
+    {
+        return;
+    }
+    auto code = tx->getResultCode();
+    // txSUCCESS means it was turned away without being checked
+    if (code != txSUCCESS && code != txBAD_SEQ)
+    {
+        app.getOverlayManager().rejectTx(tx->getFullHash());
+    }
+}
+
+// size of `msg` for flow control, which gives its credits back once the
+// transactions it carries were admitted
+static size_t
+getTxMessageSize(FlowControl const& flowControl, StellarMessage const& msg)
+{
+    return flowControl.isEnabled() ? xdr::xdr_size(msg) : 0;
+}
+
 void
 Peer::recvTransaction(StellarMessage const& msg)
 {
+    auto size = getTxMessageSize(mFlowControl, msg);
     TransactionFramePtr transaction = TransactionFrame::makeTransactionFromWire(
         mApp.getNetworkID(), msg.transaction());
     if (transaction)
     {
         // add it to our current set
         // and make sure it is valid
-        auto recvRes = mApp.getHerder().recvTransaction(transaction);
+        std::weak_ptr<Peer> weak = shared_from_this();
+        auto& app = mApp;
+        app.getHerder().recvTransaction(
+            transaction,
+            [weak, msg, size, transaction,
+             &app](Herder::TransactionSubmitStatus recvRes) {
+                floodTransaction(app, weak, msg, recvRes);
+                rejectTransaction(app, transaction, recvRes);
+                auto self = weak.lock();
+                if (self)
+                {
+                    self->messageProcessed(TRANSACTION, size);
+                }
+            });
+    }
+    else
+    {
+        messageProcessed(TRANSACTION, size);
+    }
+}
 
-        if (recvRes == Herder::TX_STATUS_PENDING ||
-            recvRes == Herder::TX_STATUS_DUPLICATE)
+void
+Peer::recvTransactions(StellarMessage const& msg)
+{
+    auto size = getTxMessageSize(mFlowControl, msg);
+    std::vector<TransactionFramePtr> transactions;
+    transactions.reserve(msg.transactions().size());
+    for (auto const& env : msg.transactions())
+    {
+        auto transaction = TransactionFrame::makeTransactionFromWire(
+            mApp.getNetworkID(), env);
+        if (transaction)
         {
-            // record that this peer sent us this transaction
-            mApp.getOverlayManager().recvFloodedMsg(msg, shared_from_this());
+            transactions.emplace_back(transaction);
+        }
+    }
+
+    if (transactions.empty())
+    {
+        messageProcessed(TRANSACTIONS, size);
+        return;
+    }
 
-            if (recvRes == Herder::TX_STATUS_PENDING)
+    // each transaction is then flooded on its own, as if it was received in
+    // a TRANSACTION message; the message is processed once all of them were
+    std::weak_ptr<Peer> weak = shared_from_this();
+    auto& app = mApp;
+    auto left = std::make_shared<size_t>(transactions.size());
+    app.getHerder().recvTransactions(
+        transactions,
+        [weak, left, size, &app](TransactionFramePtr const& tx,
+                                 Herder::TransactionSubmitStatus recvRes) {
+            if (recvRes == Herder::TX_STATUS_PENDING ||
+                recvRes == Herder::TX_STATUS_DUPLICATE)
             {
-                // if it's a new transaction, broadcast it
-                mApp.getOverlayManager().broadcastMessage(msg);
+                floodTransaction(app, weak, tx->toStellarMessage(), recvRes);
             }
-        }
-    }
+            rejectTransaction(app, tx, recvRes);
+            if (--*left == 0)
+            {
+                auto self = weak.lock();
+                if (self)
+                {
+                    self->messageProcessed(TRANSACTIONS, size);
+                }
+            }
+        });
 }
 
 void
@@ -804,6 +1291,7 @@ void
 Peer::recvSCPQuorumSet(StellarMessage const& msg)
 {
     Hash hash = sha256(xdr::xdr_to_opaque(msg.qSet()));
+    noteFetchReply(hash);
     mApp.getHerder().recvSCPQuorumSet(hash, msg.qSet());
 }
 
@@ -838,6 +1326,183 @@ Peer::recvGetSCPState(StellarMessage const& msg)
     mApp.getHerder().sendSCPStateToPeer(seq, shared_from_this());
 }
 
+void
+Peer::recvFloodAdvert(StellarMessage const& msg)
+{
+    StellarMessage demand;
+    demand.type(FLOOD_DEMAND);
+    auto& txHashes = demand.floodDemand().txHashes;
+    auto self = shared_from_this();
+    for (auto const& h : msg.floodAdvert().txHashes)
+    {
+        if (mApp.getOverlayManager().recvTxAdvert(h, self))
+        {
+            txHashes.emplace_back(h);
+        }
+    }
+
+    if (!txHashes.empty())
+    {
+        sendMessage(demand);
+    }
+}
+
+void
+Peer::recvFloodDemand(StellarMessage const& msg)
+{
+    StellarMessage batch;
+    batch.type(TRANSACTIONS);
+    auto& transactions = batch.transactions();
+    bool batched = isTxBatchEnabled();
+
+    for (auto const& h : msg.floodDemand().txHashes)
+    {
+        // transactions that are not pending anymore are not sent: they made
+        // it into a ledger or were evicted
+        auto tx = mApp.getHerder().getTx(h);
+        if (!tx)
+        {
+            continue;
+        }
+
+        if (!batched)
+        {
+            sendMessage(tx->toStellarMessage());
+            continue;
+        }
+
+        transactions.emplace_back(tx->getEnvelope());
+        if (transactions.size() == TX_BATCH_MAX_SIZE)
+        {
+            sendMessage(batch);
+            transactions.clear();
+        }
+    }
+
+    if (!transactions.empty())
+    {
+        sendMessage(batch);
+    }
+}
+
+void
+Peer::recvSendMore(StellarMessage const& msg)
+{
+    mFlowControl.addCredits(msg.sendMore());
+    creditsGranted();
+}
+
+bool
+Peer::isPullModeEnabled() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_PULL_MODE &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               FIRST_OVERLAY_VERSION_WITH_PULL_MODE;
+}
+
+void
+Peer::noteFetchRequest(Hash const& itemHash)
+{
+    auto now = mApp.getClock().now();
+    for (auto it = mFetchRequests.begin(); it != mFetchRequests.end();)
+    {
+        if (now - it->second >= MAX_FETCH_LATENCY)
+        {
+            updateFetchLatency(MAX_FETCH_LATENCY);
+            it = mFetchRequests.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    mFetchRequests[itemHash] = now;
+}
+
+void
+Peer::noteFetchReply(Hash const& itemHash)
+{
+    auto it = mFetchRequests.find(itemHash);
+    if (it == mFetchRequests.end())
+    {
+        return;
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        mApp.getClock().now() - it->second);
+    updateFetchLatency(std::min(latency, MAX_FETCH_LATENCY));
+    mFetchRequests.erase(it);
+}
+
+void
+Peer::updateFetchLatency(std::chrono::milliseconds latency)
+{
+    // recent answers weigh a quarter
+    mFetchLatency = (mFetchLatency * 3 + latency) / 4;
+}
+
+bool
+Peer::isTxBatchEnabled() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_TX_BATCH &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               FIRST_OVERLAY_VERSION_WITH_TX_BATCH;
+}
+
+bool
+Peer::isCompactTxSetEnabled() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_COMPACT_TX_SET &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               FIRST_OVERLAY_VERSION_WITH_COMPACT_TX_SET;
+}
+
+bool
+Peer::isFlowControlEnabled() const
+{
+    return mRemoteOverlayVersion >= FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL;
+}
+
+void
+Peer::queueTxAdvert(Hash const& txHash)
+{
+    mTxAdverts.emplace_back(txHash);
+    if (mTxAdverts.size() == TX_ADVERT_VECTOR_MAX_SIZE)
+    {
+        flushTxAdverts();
+    }
+    else if (mTxAdverts.size() == 1)
+    {
+        std::weak_ptr<Peer> weak = shared_from_this();
+        mTxAdvertTimer.expires_from_now(TX_ADVERT_PERIOD);
+        mTxAdvertTimer.async_wait([weak](asio::error_code const& error) {
+            auto self = weak.lock();
+            if (!error && self)
+            {
+                self->flushTxAdverts();
+            }
+        });
+    }
+}
+
+void
+Peer::flushTxAdverts()
+{
+    mTxAdvertTimer.cancel();
+    if (mTxAdverts.empty() || shouldAbort())
+    {
+        return;
+    }
+
+    StellarMessage msg;
+    msg.type(FLOOD_ADVERT);
+    msg.floodAdvert().txHashes.assign(mTxAdverts.begin(), mTxAdverts.end());
+    mTxAdverts.clear();
+    sendMessage(msg);
+}
+
 void
 Peer::recvError(StellarMessage const& msg)
 {
@@ -1055,6 +1720,15 @@ Peer::recvAuth(StellarMessage const& msg)
 
     auto self = shared_from_this();
 
+    // started before anything taking credits is sent; the peer only sends
+    // such messages once it got ours, which follow our AUTH
+    StellarMessage sendMore;
+    if (isFlowControlEnabled())
+    {
+        sendMore.type(SEND_MORE);
+        sendMore.sendMore() = mFlowControl.start();
+    }
+
     if (mRole == REMOTE_CALLED_US)
     {
         sendAuth();
@@ -1069,6 +1743,11 @@ Peer::recvAuth(StellarMessage const& msg)
         return;
     }
 
+    if (mFlowControl.isEnabled())
+    {
+        sendMessage(sendMore);
+    }
+
     noteHandshakeSuccessInPeerRecord();
 
     // send SCP State
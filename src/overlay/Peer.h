@@ -6,12 +6,17 @@
 
 #include "util/asio.h"
 #include "database/Database.h"
+#include "overlay/FlowControl.h"
 #include "overlay/PeerBareAddress.h"
+#include "overlay/SerializedMessage.h"
 #include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include "xdrpp/message.h"
 
+#include <unordered_map>
+
 namespace medida
 {
 class Timer;
@@ -23,6 +28,15 @@ namespace stellar
 
 typedef std::shared_ptr<SCPQuorumSet> SCPQuorumSetPtr;
 
+// first overlay version with FLOOD_ADVERT and FLOOD_DEMAND
+static uint32_t const FIRST_OVERLAY_VERSION_WITH_PULL_MODE = 8;
+// first overlay version with TRANSACTIONS
+static uint32_t const FIRST_OVERLAY_VERSION_WITH_TX_BATCH = 9;
+// first overlay version with GET_COMPACT_TX_SET and COMPACT_TX_SET
+static uint32_t const FIRST_OVERLAY_VERSION_WITH_COMPACT_TX_SET = 10;
+// first overlay version with SEND_MORE
+static uint32_t const FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL = 11;
+
 class Application;
 class LoopbackPeer;
 
@@ -54,6 +68,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
     static medida::Meter& getByteReadMeter(Application& app);
     static medida::Meter& getByteWriteMeter(Application& app);
 
+    // short id of the transaction with full hash `txHash` in the compact form
+    // of the tx set with hash `txSetHash`
+    static ShortTxID getShortTxID(Hash const& txSetHash, Hash const& txHash);
+
   protected:
     Application& mApp;
 
@@ -74,6 +92,22 @@ class Peer : public std::enable_shared_from_this<Peer>,
     PeerBareAddress mAddress;
 
     VirtualTimer mIdleTimer;
+
+    // transactions to advertise, sent in batches
+    std::vector<Hash> mTxAdverts;
+    VirtualTimer mTxAdvertTimer;
+
+    // tx sets and quorum sets asked to this peer and not answered yet, with
+    // the time they were asked
+    std::unordered_map<Hash, VirtualClock::time_point> mFetchRequests;
+    // moving average of the time this peer takes to answer them
+    std::chrono::milliseconds mFetchLatency;
+    // tx sets asked in compact form to this peer, with the time they were
+    // asked; other compact tx sets it sends are ignored
+    std::unordered_map<Hash, VirtualClock::time_point> mCompactTxSetRequests;
+
+    // credits granted to and by this peer
+    FlowControl mFlowControl;
     VirtualClock::time_point mLastRead;
     VirtualClock::time_point mLastWrite;
 
@@ -98,6 +132,12 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Timer& mRecvSCPQuorumSetTimer;
     medida::Timer& mRecvSCPMessageTimer;
     medida::Timer& mRecvGetSCPStateTimer;
+    medida::Timer& mRecvFloodAdvertTimer;
+    medida::Timer& mRecvFloodDemandTimer;
+    medida::Timer& mRecvTransactionsTimer;
+    medida::Timer& mRecvGetCompactTxSetTimer;
+    medida::Timer& mRecvCompactTxSetTimer;
+    medida::Timer& mRecvSendMoreTimer;
 
     medida::Timer& mRecvSCPPrepareTimer;
     medida::Timer& mRecvSCPConfirmTimer;
@@ -117,12 +157,23 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mSendSCPQuorumSetMeter;
     medida::Meter& mSendSCPMessageSetMeter;
     medida::Meter& mSendGetSCPStateMeter;
+    medida::Meter& mSendFloodAdvertMeter;
+    medida::Meter& mSendFloodDemandMeter;
+    medida::Meter& mSendTransactionsMeter;
+    medida::Meter& mSendGetCompactTxSetMeter;
+    medida::Meter& mSendCompactTxSetMeter;
+    medida::Meter& mSendSendMoreMeter;
+
+    medida::Meter& mCompactTxSetCompleteMeter;
+    medida::Meter& mCompactTxSetMissingMeter;
+    medida::Meter& mCompactTxSetFallbackMeter;
 
     medida::Meter& mDropInConnectHandlerMeter;
     medida::Meter& mDropInRecvMessageDecodeMeter;
     medida::Meter& mDropInRecvMessageSeqMeter;
     medida::Meter& mDropInRecvMessageMacMeter;
     medida::Meter& mDropInRecvMessageUnauthMeter;
+    medida::Meter& mDropInRecvMessageFlowControlMeter;
     medida::Meter& mDropInRecvHelloUnexpectedMeter;
     medida::Meter& mDropInRecvHelloVersionMeter;
     medida::Meter& mDropInRecvHelloSelfMeter;
@@ -136,10 +187,28 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mDropInRecvAuthInvalidPeerMeter;
     medida::Meter& mDropInRecvErrorMeter;
 
+    medida::Meter& mRecvDuplicateMeter;
+
     bool shouldAbort() const;
     void recvMessage(StellarMessage const& msg);
-    void recvMessage(AuthenticatedMessage const& msg);
+    // `macVerified` is set when the MAC was checked beforehand against the
+    // sequence number the message carries
+    void recvMessage(AuthenticatedMessage const& msg, bool macVerified = false);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
+    // a flooded message this node already knows, identified by `index`,
+    // whose MAC was checked without decoding it; `size` is the size of its
+    // encoding
+    void recvDuplicateMessage(uint64 sequence, Hash const& index,
+                              size_t size);
+    // returns false, and drops the peer, if `sequence` is not the next one
+    bool checkRecvSequence(uint64 sequence);
+    // returns false, and drops the peer, if it had no credits left for a
+    // message of that type and size
+    bool checkRecvCredits(MessageType type, size_t size);
+    // grants the peer more credits once enough of its messages were processed
+    void maybeSendMore();
+    // gives back the credits taken by a message once it was processed
+    void messageProcessed(MessageType type, size_t size);
 
     virtual void recvError(StellarMessage const& msg);
     // returns false if we should drop this peer
@@ -152,11 +221,25 @@ class Peer : public std::enable_shared_from_this<Peer>,
 
     void recvGetTxSet(StellarMessage const& msg);
     void recvTxSet(StellarMessage const& msg);
+    void recvGetCompactTxSet(StellarMessage const& msg);
+    void recvCompactTxSet(StellarMessage const& msg);
     void recvTransaction(StellarMessage const& msg);
+    void recvTransactions(StellarMessage const& msg);
     void recvGetSCPQuorumSet(StellarMessage const& msg);
     void recvSCPQuorumSet(StellarMessage const& msg);
     void recvSCPMessage(StellarMessage const& msg);
     void recvGetSCPState(StellarMessage const& msg);
+    void recvFloodAdvert(StellarMessage const& msg);
+    void recvFloodDemand(StellarMessage const& msg);
+    void recvSendMore(StellarMessage const& msg);
+
+    void flushTxAdverts();
+
+    void noteFetchRequest(Hash const& itemHash);
+    void noteFetchReply(Hash const& itemHash);
+    void sendGetCompactTxSet(Hash const& setID,
+                             xdr::xvector<ShortTxID> missing = {});
+    void updateFetchLatency(std::chrono::milliseconds latency);
 
     void sendHello();
     void sendAuth();
@@ -164,19 +247,27 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendDontHave(MessageType type, uint256 const& itemID);
     void sendPeers();
 
-    // NB: This is a move-argument because the write-buffer has to travel
-    // with the write-request through the async IO system, and we might have
-    // several queued at once. We have carefully arranged this to not copy
-    // data more than the once necessary into this buffer, but it can't be
-    // put in a reused/non-owned buffer without having to buffer/queue
-    // messages somewhere else. The async write request will point _into_
-    // this owned buffer. This is really the best we can do.
-    virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+    // Hands a message to the transport, which may queue it (and reorder or
+    // shed queued messages) as long as it authenticates the messages it
+    // writes, in the order it writes them, with `authenticate`.
+    virtual void queueMessage(SerializedMessagePtr msg) = 0;
+
+    // NB: the frame holds the message body shared with the other peers the
+    // message is sent to; async write requests point _into_ the frame and
+    // that shared body, so the frame has to live until the write is done.
+    AuthenticatedFrame authenticate(SerializedMessagePtr msg);
     virtual void
     connected()
     {
     }
 
+    // called when the peer grants credits, so that the transport can send
+    // the messages that were waiting for them
+    virtual void
+    creditsGranted()
+    {
+    }
+
     virtual AuthCert getAuthCert();
     virtual PeerBareAddress makeAddress(int remoteListeningPort) const = 0;
 
@@ -201,8 +292,30 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendGetPeers();
     void sendGetScpState(uint32 ledgerSeq);
 
+    // estimate of the time this peer takes to answer a request for a tx set
+    // or a quorum set
+    std::chrono::milliseconds
+    getFetchLatency() const
+    {
+        return mFetchLatency;
+    }
+
     void sendMessage(StellarMessage const& msg);
 
+    // true if transactions are advertised to this peer rather than sent
+    bool isPullModeEnabled() const;
+    // true if transactions can be sent to this peer in TRANSACTIONS batches
+    bool isTxBatchEnabled() const;
+    // true if tx sets are fetched from this peer in compact form
+    bool isCompactTxSetEnabled() const;
+    // true if messages to and from this peer are limited by credits
+    bool isFlowControlEnabled() const;
+    // advertises the transaction with full hash `txHash`; adverts are
+    // batched for a short time
+    void queueTxAdvert(Hash const& txHash);
+    // sends a message serialized beforehand, possibly for several peers
+    void sendMessage(SerializedMessagePtr msg);
+
     PeerRole
     getRole() const
     {
@@ -255,7 +368,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     virtual void connectHandler(asio::error_code const& ec);
 
     virtual void
-    writeHandler(asio::error_code const& error, size_t bytes_transferred)
+    writeHandler(asio::error_code const& error, size_t bytes_transferred,
+                 size_t messages_transferred)
     {
     }
 
@@ -0,0 +1,86 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/SerializedMessage.h"
+#include "crypto/SHA.h"
+#include "xdrpp/marshal.h"
+
+#include <cstring>
+
+namespace stellar
+{
+
+SerializedMessage::SerializedMessage(StellarMessage const& msg)
+    : mType(msg.type()), mBytes(xdr::xdr_to_opaque(msg))
+{
+}
+
+Hash const&
+SerializedMessage::getHash() const
+{
+    if (!mHashed)
+    {
+        mHash = sha256(mBytes);
+        mHashed = true;
+    }
+    return mHash;
+}
+
+static void
+putUint32(uint8_t* out, uint32_t v)
+{
+    out[0] = static_cast<uint8_t>(v >> 24);
+    out[1] = static_cast<uint8_t>(v >> 16);
+    out[2] = static_cast<uint8_t>(v >> 8);
+    out[3] = static_cast<uint8_t>(v);
+}
+
+AuthenticatedFrame::AuthenticatedFrame(SerializedMessagePtr msg,
+                                       uint64 sequence,
+                                       HmacSha256Mac const& mac)
+    : mMessage(std::move(msg)), mMac(mac)
+{
+    auto bodySize = size() - 4;
+    // record mark, with the "last fragment" bit set as in xdr::message_t
+    putUint32(mHeader.data(), static_cast<uint32_t>(bodySize) | 0x80000000);
+    // AuthenticatedMessage version
+    putUint32(mHeader.data() + 4, 0);
+    putUint32(mHeader.data() + 8, static_cast<uint32_t>(sequence >> 32));
+    putUint32(mHeader.data() + 12, static_cast<uint32_t>(sequence));
+}
+
+size_t
+AuthenticatedFrame::size() const
+{
+    return getSize(*mMessage);
+}
+
+size_t
+AuthenticatedFrame::getSize(SerializedMessage const& msg)
+{
+    return HEADER_SIZE + msg.getBytes().size() + HmacSha256Mac{}.mac.size();
+}
+
+std::array<asio::const_buffer, 3>
+AuthenticatedFrame::buffers() const
+{
+    auto const& body = mMessage->getBytes();
+    return {{asio::buffer(mHeader), asio::buffer(body.data(), body.size()),
+             asio::buffer(mMac.mac.data(), mMac.mac.size())}};
+}
+
+xdr::msg_ptr
+AuthenticatedFrame::toMsg() const
+{
+    auto const& body = mMessage->getBytes();
+    auto res = xdr::message_t::alloc(size() - 4);
+    auto out = reinterpret_cast<uint8_t*>(res->raw_data());
+    std::memcpy(out, mHeader.data(), mHeader.size());
+    out += mHeader.size();
+    std::memcpy(out, body.data(), body.size());
+    out += body.size();
+    std::memcpy(out, mMac.mac.data(), mMac.mac.size());
+    return res;
+}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include "xdrpp/message.h"
+
+#include <array>
+#include <memory>
+
+namespace stellar
+{
+
+/*
+SerializedMessage
+A StellarMessage encoded once, shared by every peer it is sent to.
+
+Peers only add what is specific to them around these bytes (see
+AuthenticatedFrame), so broadcasting a message to many peers costs a single
+serialization, and a single hash.
+*/
+class SerializedMessage : NonMovableOrCopyable
+{
+  public:
+    explicit SerializedMessage(StellarMessage const& msg);
+
+    MessageType
+    getType() const
+    {
+        return mType;
+    }
+
+    // XDR encoding of the message
+    xdr::opaque_vec<> const&
+    getBytes() const
+    {
+        return mBytes;
+    }
+
+    // sha256 of the encoding, the index of the message in the Floodgate
+    Hash const& getHash() const;
+
+  private:
+    MessageType const mType;
+    xdr::opaque_vec<> const mBytes;
+    mutable Hash mHash;
+    mutable bool mHashed{false};
+};
+
+typedef std::shared_ptr<SerializedMessage const> SerializedMessagePtr;
+
+/*
+AuthenticatedFrame
+An AuthenticatedMessage as written on the wire to one peer, in three pieces:
+the record mark, version and sequence number; the shared message body; the
+MAC. The pieces can be handed to a scatter-gather write as they are.
+*/
+class AuthenticatedFrame
+{
+  public:
+    // size of the record mark, union discriminant and sequence number
+    static size_t const HEADER_SIZE = 16;
+
+    AuthenticatedFrame(SerializedMessagePtr msg, uint64 sequence,
+                       HmacSha256Mac const& mac);
+
+    SerializedMessage const&
+    getMessage() const
+    {
+        return *mMessage;
+    }
+
+    // bytes on the wire, record mark included
+    size_t size() const;
+    static size_t getSize(SerializedMessage const& msg);
+
+    // the buffers point into this frame, which must outlive the write
+    std::array<asio::const_buffer, 3> buffers() const;
+
+    // contiguous copy of the frame
+    xdr::msg_ptr toMsg() const;
+
+  private:
+    std::array<uint8_t, HEADER_SIZE> mHeader;
+    SerializedMessagePtr mMessage;
+    HmacSha256Mac mMac;
+};
+}
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/TCPPeer.h"
+#include "crypto/SHA.h"
 #include "database/Database.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -29,7 +30,7 @@ using namespace std;
 
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+    : Peer(app, role), mSocket(socket), mOutboundQueue(app)
 {
 }
 
@@ -130,7 +131,7 @@ TCPPeer::makeAddress(int remoteListeningPort) const
 }
 
 void
-TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
+TCPPeer::queueMessage(SerializedMessagePtr msg)
 {
     if (mState == CLOSING)
     {
@@ -143,12 +144,16 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
         CLOG(TRACE, "Overlay") << "TCPPeer:sendMessage to " << toString();
     assertThreadIsMain();
 
-    // places the buffer to write into the write queue
-    auto buf = std::make_shared<xdr::msg_ptr>(std::move(xdrBytes));
-
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
-    self->mWriteQueue.emplace(buf);
+    // places the message into the outbound queue
+    if (!self->mOutboundQueue.push(std::move(msg)))
+    {
+        CLOG(WARNING, "Overlay")
+            << "Outbound queue overflow, dropping " << toString();
+        drop();
+        return;
+    }
 
     if (!self->mWriting)
     {
@@ -221,46 +226,63 @@ TCPPeer::messageSender()
 {
     assertThreadIsMain();
 
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    // take as many messages, by priority, as fit in a single write and have
+    // credits; they are only authenticated now, as the outbound queue may
+    // reorder or shed messages until then
+    mWriteBatch.clear();
+    mWriteBuffers.clear();
+    size_t batchBytes = 0;
+    auto accept = [&](SerializedMessage const& msg) {
+        auto size = AuthenticatedFrame::getSize(msg);
+        return (mWriteBatch.empty() ||
+                batchBytes + size <= MAX_WRITE_BATCH_SIZE) &&
+               mFlowControl.trySend(msg);
+    };
+    while (mWriteBatch.size() < MAX_WRITE_BATCH_MESSAGES)
+    {
+        auto msg = mOutboundQueue.popFirst(accept);
+        if (!msg)
+        {
+            break;
+        }
+        batchBytes += AuthenticatedFrame::getSize(*msg);
+        mWriteBatch.emplace_back(authenticate(std::move(msg)));
+    }
 
-    // if nothing to do, flush and return
-    if (mWriteQueue.empty())
+    // if nothing to do, return; messages waiting for credits are sent by
+    // creditsGranted
+    if (mWriteBatch.empty())
     {
-        mSocket->async_flush([self](asio::error_code const& ec, std::size_t) {
-            self->writeHandler(ec, 0);
-            if (!ec)
-            {
-                if (!self->mWriteQueue.empty())
-                {
-                    self->messageSender();
-                }
-                else
-                {
-                    self->mWriting = false;
-                    // there is nothing to send and delayed shutdown was
-                    // requested - time to perform it
-                    if (self->mDelayedShutdown)
-                    {
-                        self->shutdown();
-                    }
-                }
-            }
-        });
+        mWriting = false;
+        // there is nothing to send and delayed shutdown was requested - time
+        // to perform it
+        if (mDelayedShutdown)
+        {
+            shutdown();
+        }
         return;
     }
 
-    // peek the buffer from the queue
-    // do not remove it yet as we need the buffer for the duration of the
-    // write operation
-    auto buf = mWriteQueue.front();
+    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    // the batch does not grow past this point, its frames keep their address
+    for (auto const& frame : mWriteBatch)
+    {
+        auto buffers = frame.buffers();
+        mWriteBuffers.insert(mWriteBuffers.end(), buffers.begin(),
+                             buffers.end());
+    }
 
-    asio::async_write(*(mSocket.get()),
-                      asio::buffer((*buf)->raw_data(), (*buf)->raw_size()),
+    // writes bypass the buffered stream, which would only copy the frames
+    // once more
+    asio::async_write(mSocket->next_layer(), mWriteBuffers,
                       [self](asio::error_code const& ec, std::size_t length) {
-                          self->writeHandler(ec, length);
-                          self->mWriteQueue.pop(); // done with front element
+                          self->writeHandler(ec, length,
+                                             self->mWriteBatch.size());
+                          // done with the batch
+                          self->mWriteBatch.clear();
+                          self->mWriteBuffers.clear();
 
-                          // continue processing the queue/flush
+                          // continue processing the queue
                           if (!ec)
                           {
                               self->messageSender();
@@ -268,9 +290,20 @@ TCPPeer::messageSender()
                       });
 }
 
+void
+TCPPeer::creditsGranted()
+{
+    if (!mWriting)
+    {
+        mWriting = true;
+        messageSender();
+    }
+}
+
 void
 TCPPeer::writeHandler(asio::error_code const& error,
-                      std::size_t bytes_transferred)
+                      std::size_t bytes_transferred,
+                      std::size_t messages_transferred)
 {
     assertThreadIsMain();
     mLastWrite = mApp.getClock().now();
@@ -299,7 +332,7 @@ TCPPeer::writeHandler(asio::error_code const& error,
     else if (bytes_transferred != 0)
     {
         LoadManager::PeerContext loadCtx(mApp, mPeerID);
-        mMessageWrite.Mark();
+        mMessageWrite.Mark(messages_transferred);
         mByteWrite.Mark(bytes_transferred);
     }
 }
@@ -415,8 +448,23 @@ TCPPeer::readBodyHandler(asio::error_code const& error,
     if (!error)
     {
         receivedBytes(bytes_transferred, true);
-        recvMessage();
-        mIncomingHeader.clear();
+        if (isAuthenticated())
+        {
+            recvMessageAsync();
+            mIncomingHeader.clear();
+            if (mIncomingQueue.size() >= MAX_INCOMING_QUEUE_SIZE)
+            {
+                // resumed by processIncomingQueue
+                mReadPaused = true;
+                return;
+            }
+        }
+        else
+        {
+            // handshake messages change how the next ones are authenticated
+            recvMessage();
+            mIncomingHeader.clear();
+        }
         startRead();
     }
     else
@@ -453,6 +501,158 @@ TCPPeer::recvMessage()
     }
 }
 
+void
+TCPPeer::recvMessageAsync()
+{
+    assertThreadIsMain();
+    auto msg = std::make_shared<IncomingMessage>();
+    msg->mBody.swap(mIncomingBody);
+    mIncomingQueue.emplace_back(msg);
+
+    // the peer is only referenced weakly from the other threads, so that it
+    // is always destroyed on the main thread
+    std::weak_ptr<TCPPeer> weak =
+        static_pointer_cast<TCPPeer>(shared_from_this());
+    auto key = mRecvMacKey;
+    auto& app = mApp;
+    mApp.getWorkerIOService().post([weak, msg, key, &app]() {
+        verifyIncomingMessage(*msg, key, app.getOverlayManager());
+        app.getClock().getIOService().post([weak, msg]() {
+            msg->mDone = true;
+            auto self = weak.lock();
+            if (self)
+            {
+                self->processIncomingQueue();
+            }
+        });
+    });
+}
+
+static uint32_t
+readUint32(uint8_t const* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+bool
+TCPPeer::checkDuplicate(IncomingMessage& msg, HmacSha256Key const& key,
+                        OverlayManager& overlay)
+{
+    // the body is the encoding of an AuthenticatedMessage: union
+    // discriminant, sequence number, StellarMessage (starting with its
+    // type), MAC
+    auto const& body = msg.mBody;
+    HmacSha256Mac mac;
+    auto macSize = mac.mac.size();
+    if (body.size() < 16 + macSize || readUint32(body.data()) != 0 ||
+        readUint32(body.data() + 12) != TRANSACTION)
+    {
+        return false;
+    }
+
+    // the encoding of the message is what the FloodGate hashes
+    auto macOffset = body.size() - macSize;
+    auto index = sha256(ByteSlice(body.data() + 12, macOffset - 12));
+    if (!overlay.isFloodedMsgKnown(index))
+    {
+        return false;
+    }
+
+    std::copy(body.begin() + macOffset, body.end(), mac.mac.begin());
+    if (!hmacSha256Verify(mac, key,
+                          ByteSlice(body.data() + 4, macOffset - 4)))
+    {
+        // decoded and rejected by the regular checks
+        return false;
+    }
+
+    msg.mSequence = (uint64(readUint32(body.data() + 4)) << 32) |
+                    readUint32(body.data() + 8);
+    msg.mFloodHash = index;
+    msg.mMessageSize = macOffset - 12;
+    msg.mMacValid = true;
+    msg.mDuplicate = true;
+    return true;
+}
+
+void
+TCPPeer::verifyIncomingMessage(IncomingMessage& msg, HmacSha256Key const& key,
+                               OverlayManager& overlay)
+{
+    // most flooded transactions are relayed by several peers: the copies of
+    // a known one are dropped before being decoded
+    if (checkDuplicate(msg, key, overlay))
+    {
+        return;
+    }
+
+    try
+    {
+        xdr::xdr_get g(msg.mBody.data(), msg.mBody.data() + msg.mBody.size());
+        xdr::xdr_argpack_archive(g, msg.mMessage);
+        g.done();
+        msg.mDecoded = true;
+    }
+    catch (xdr::xdr_runtime_error& e)
+    {
+        msg.mError = e.what();
+        return;
+    }
+
+    auto const& v0 = msg.mMessage.v0();
+    if (v0.message.type() == ERROR_MSG)
+    {
+        // errors are not authenticated
+        return;
+    }
+
+    // the MAC covers the encoding of (sequence, message), which are the
+    // bytes between the union discriminant and the MAC
+    auto macSize = v0.mac.mac.size();
+    msg.mMacValid = hmacSha256Verify(
+        v0.mac, key,
+        ByteSlice(msg.mBody.data() + 4, msg.mBody.size() - 4 - macSize));
+}
+
+void
+TCPPeer::processIncomingQueue()
+{
+    assertThreadIsMain();
+    while (!mIncomingQueue.empty() && mIncomingQueue.front()->mDone)
+    {
+        if (shouldAbort())
+        {
+            return;
+        }
+
+        auto msg = mIncomingQueue.front();
+        mIncomingQueue.pop_front();
+        if (msg->mDuplicate)
+        {
+            recvDuplicateMessage(msg->mSequence, msg->mFloodHash,
+                                 msg->mMessageSize);
+            continue;
+        }
+        if (!msg->mDecoded)
+        {
+            CLOG(ERROR, "Overlay")
+                << "recvMessage got a corrupt xdr: " << msg->mError;
+            Peer::drop(ERR_DATA, "received corrupt XDR");
+            return;
+        }
+        // the sequence number is checked here, in order; messages with an
+        // invalid MAC go through the regular checks, which reject them
+        Peer::recvMessage(msg->mMessage, msg->mMacValid);
+    }
+
+    if (mReadPaused && mIncomingQueue.size() < MAX_INCOMING_QUEUE_SIZE)
+    {
+        mReadPaused = false;
+        startRead();
+    }
+}
+
 void
 TCPPeer::drop(bool force)
 {
@@ -4,9 +4,11 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "overlay/OutboundQueue.h"
 #include "overlay/Peer.h"
 #include "util/Timer.h"
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace medida
 {
@@ -15,9 +17,18 @@ class Meter;
 
 namespace stellar
 {
+class OverlayManager;
 
 static auto const MAX_UNAUTH_MESSAGE_SIZE = 0x1000;
 static auto const MAX_MESSAGE_SIZE = 0x1000000;
+// queued messages are coalesced into writes of at most that many bytes (a
+// single larger message is written alone) and that many messages, as asio
+// hands at most 64 buffers to a system call and each message takes 3
+static size_t const MAX_WRITE_BATCH_SIZE = 0x40000;
+static size_t const MAX_WRITE_BATCH_MESSAGES = 21;
+// reading from a peer pauses while that many of its messages are being
+// decoded and authenticated
+static size_t const MAX_INCOMING_QUEUE_SIZE = 64;
 
 // Peer that communicates via a TCP socket.
 class TCPPeer : public Peer
@@ -30,7 +41,31 @@ class TCPPeer : public Peer
     std::vector<uint8_t> mIncomingHeader;
     std::vector<uint8_t> mIncomingBody;
 
-    std::queue<std::shared_ptr<xdr::msg_ptr>> mWriteQueue;
+    // once the peer is authenticated, its messages are decoded and their MAC
+    // checked on the worker threads; they are handed back to the main thread
+    // in the order they were received
+    struct IncomingMessage
+    {
+        std::vector<uint8_t> mBody;
+        AuthenticatedMessage mMessage;
+        std::string mError;
+        bool mDecoded{false};
+        bool mMacValid{false};
+        bool mDone{false};
+        // set for flooded transactions already known, which are not decoded
+        bool mDuplicate{false};
+        uint64 mSequence{0};
+        Hash mFloodHash;
+        size_t mMessageSize{0};
+    };
+    std::deque<std::shared_ptr<IncomingMessage>> mIncomingQueue;
+    bool mReadPaused{false};
+
+    // messages waiting to be written
+    OutboundQueue mOutboundQueue;
+    // frames being written from mWriteBuffers
+    std::vector<AuthenticatedFrame> mWriteBatch;
+    std::vector<asio::const_buffer> mWriteBuffers;
     bool mWriting{false};
     bool mDelayedShutdown{false};
     bool mShutdownScheduled{false};
@@ -38,16 +73,26 @@ class TCPPeer : public Peer
     PeerBareAddress makeAddress(int remoteListeningPort) const override;
 
     void recvMessage();
-    void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void recvMessageAsync();
+    void processIncomingQueue();
+    // runs on a worker thread
+    static void verifyIncomingMessage(IncomingMessage& msg,
+                                      HmacSha256Key const& key,
+                                      OverlayManager& overlay);
+    static bool checkDuplicate(IncomingMessage& msg, HmacSha256Key const& key,
+                               OverlayManager& overlay);
+    void queueMessage(SerializedMessagePtr msg) override;
 
     void messageSender();
+    void creditsGranted() override;
 
     int getIncomingMsgLength();
     virtual void connected() override;
     void startRead();
 
     void writeHandler(asio::error_code const& error,
-                      std::size_t bytes_transferred) override;
+                      std::size_t bytes_transferred,
+                      std::size_t messages_transferred) override;
     void readHeaderHandler(asio::error_code const& error,
                            std::size_t bytes_transferred) override;
     void readBodyHandler(asio::error_code const& error,
@@ -14,11 +14,14 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 
+#include <algorithm>
+
 namespace stellar
 {
 
 static std::chrono::milliseconds const MS_TO_WAIT_FOR_FETCH_REPLY{1500};
 static int const MAX_REBUILD_FETCH_LIST = 1000;
+static size_t const MAX_PARALLEL_FETCHES = 2;
 
 Tracker::Tracker(Application& app, Hash const& hash, AskPeer& askPeer)
     : mAskPeer(askPeer)
@@ -30,6 +33,8 @@ Tracker::Tracker(Application& app, Hash const& hash, AskPeer& askPeer)
           {"overlay", "item-fetcher", "reset-fetcher"}, "item-fetcher"))
     , mTryNextPeer(app.getMetrics().NewMeter(
           {"overlay", "item-fetcher", "next-peer"}, "item-fetcher"))
+    , mParallelFetch(app.getMetrics().NewMeter(
+          {"overlay", "item-fetcher", "parallel-fetch"}, "item-fetcher"))
 {
     assert(mAskPeer);
 }
@@ -69,7 +74,8 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
     }
 
     mTimer.cancel();
-    mLastAskedPeer = nullptr;
+    mAskedPeers.clear();
+    mAsking = false;
 
     return false;
 }
@@ -77,10 +83,13 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
 void
 Tracker::doesntHave(Peer::pointer peer)
 {
-    if (mLastAskedPeer == peer)
+    if (mAskedPeers.erase(peer) != 0)
     {
         CLOG(TRACE, "Overlay") << "Does not have " << hexAbbrev(mItemHash);
-        tryNextPeer();
+        if (mAskedPeers.empty())
+        {
+            tryNextPeer();
+        }
     }
 }
 
@@ -89,38 +98,42 @@ Tracker::tryNextPeer()
 {
     // will be called by some timer or when we get a
     // response saying they don't have it
-    Peer::pointer peer;
-
     CLOG(TRACE, "Overlay") << "tryNextPeer " << hexAbbrev(mItemHash)
-                           << " last: "
-                           << (mLastAskedPeer ? mLastAskedPeer->toString()
-                                              : "<none>");
+                           << " asked: " << mAskedPeers.size();
 
     // if we don't have a list of peers to ask and we're not
     // currently asking peers, build a new list
-    if (mPeersToAsk.empty() && !mLastAskedPeer)
+    if (mPeersToAsk.empty() && !mAsking)
     {
-        std::set<std::shared_ptr<Peer>> peersWithEnvelope;
+        mPeersWithEnvelope.clear();
         for (auto const& e : mWaitingEnvelopes)
         {
             auto const& s = mApp.getOverlayManager().getPeersKnows(e.first);
-            peersWithEnvelope.insert(s.begin(), s.end());
+            mPeersWithEnvelope.insert(s.begin(), s.end());
         }
 
-        // move the peers that have the envelope to the back,
+        // move the peers that have the envelope to the back, fastest last,
         // to be processed first
+        std::vector<Peer::pointer> withEnvelope;
         for (auto const& p :
              mApp.getOverlayManager().getRandomAuthenticatedPeers())
         {
-            if (peersWithEnvelope.find(p) != peersWithEnvelope.end())
+            if (mPeersWithEnvelope.find(p) != mPeersWithEnvelope.end())
             {
-                mPeersToAsk.emplace_back(p);
+                withEnvelope.emplace_back(p);
             }
             else
             {
                 mPeersToAsk.emplace_front(p);
             }
         }
+        std::stable_sort(withEnvelope.begin(), withEnvelope.end(),
+                         [](Peer::pointer const& a, Peer::pointer const& b) {
+                             return a->getFetchLatency() >
+                                    b->getFetchLatency();
+                         });
+        mPeersToAsk.insert(mPeersToAsk.end(), withEnvelope.begin(),
+                           withEnvelope.end());
 
         mNumListRebuild++;
 
@@ -130,21 +143,41 @@ Tracker::tryNextPeer()
         mTryNextPeerReset.Mark();
     }
 
-    while (!peer && !mPeersToAsk.empty())
+    // the peers asked before did not answer in time, they are not waited
+    // for anymore
+    mAskedPeers.clear();
+
+    // asks the next peer, and the ones after it as long as they sent one of
+    // the envelopes
+    while (!mPeersToAsk.empty() &&
+           (mAskedPeers.empty() ||
+            (mAskedPeers.size() < MAX_PARALLEL_FETCHES &&
+             mPeersWithEnvelope.find(mPeersToAsk.back()) !=
+                 mPeersWithEnvelope.end())))
     {
-        peer = mPeersToAsk.back();
+        auto peer = mPeersToAsk.back();
+        mPeersToAsk.pop_back();
         if (!peer->isAuthenticated())
         {
-            peer.reset();
+            continue;
         }
-        mPeersToAsk.pop_back();
+
+        if (!mAskedPeers.empty())
+        {
+            mParallelFetch.Mark();
+        }
+        mAskedPeers.insert(peer);
+        CLOG(TRACE, "Overlay") << "Asking for " << hexAbbrev(mItemHash)
+                               << " to " << peer->toString();
+        mTryNextPeer.Mark();
+        mAskPeer(peer, mItemHash);
     }
 
     std::chrono::milliseconds nextTry;
-    if (!peer)
+    if (mAskedPeers.empty())
     { // we have asked all our peers
-        // clear mLastAskedPeer so that we rebuild a new list
-        mLastAskedPeer.reset();
+        // clear mAsking so that we rebuild a new list
+        mAsking = false;
         if (mNumListRebuild > MAX_REBUILD_FETCH_LIST)
         {
             nextTry = MS_TO_WAIT_FOR_FETCH_REPLY * MAX_REBUILD_FETCH_LIST;
@@ -156,11 +189,7 @@ Tracker::tryNextPeer()
     }
     else
     {
-        mLastAskedPeer = peer;
-        CLOG(TRACE, "Overlay") << "Asking for " << hexAbbrev(mItemHash)
-                               << " to " << peer->toString();
-        mTryNextPeer.Mark();
-        mAskPeer(peer, mItemHash);
+        mAsking = true;
         nextTry = MS_TO_WAIT_FOR_FETCH_REPLY;
     }
 
@@ -197,6 +226,7 @@ void
 Tracker::cancel()
 {
     mTimer.cancel();
+    mAskedPeers.clear();
     mLastSeenSlotIndex = 0;
 }
 }
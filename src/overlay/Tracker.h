@@ -12,6 +12,12 @@
  * with new set of peers (possibly overlapping, as peers may learned about
  * this data set in meantime).
  *
+ * Peers that sent one of the envelopes waiting for the data set are asked
+ * first, fastest to answer first (@see Peer::getFetchLatency). Up to
+ * MAX_PARALLEL_FETCHES of them are asked at once, so that a slow peer does
+ * not delay the data set by a whole timeout; the first answer cancels the
+ * other requests.
+ *
  * For asking a AskPeer delegate is used.
  *
  * Tracker keeps list of envelopes that requires given data set to be
@@ -24,7 +30,9 @@
 #include "util/Timer.h"
 #include "xdr/Stellar-types.h"
 
+#include <deque>
 #include <functional>
+#include <set>
 #include <utility>
 #include <vector>
 
@@ -40,7 +48,11 @@ class Tracker
   private:
     AskPeer mAskPeer;
     Application& mApp;
-    Peer::pointer mLastAskedPeer;
+    // peers asked in the current try, that did not answer yet
+    std::set<Peer::pointer> mAskedPeers;
+    // true until every peer of mPeersToAsk was asked
+    bool mAsking{false};
+    std::set<Peer::pointer> mPeersWithEnvelope;
     int mNumListRebuild;
     std::deque<Peer::pointer> mPeersToAsk;
     VirtualTimer mTimer;
@@ -48,6 +60,7 @@ class Tracker
     Hash mItemHash;
     medida::Meter& mTryNextPeerReset;
     medida::Meter& mTryNextPeer;
+    medida::Meter& mParallelFetch;
     uint64 mLastSeenSlotIndex{0};
 
   public:
@@ -116,13 +129,13 @@ class Tracker
 
     /**
      * Called when given @p peer informs that it does not have given data.
-     * Next peer will be tried if available.
+     * Next peers will be tried if no other asked peer is left.
      */
     void doesntHave(Peer::pointer peer);
 
     /**
-     * Called either when @see doesntHave(Peer::pointer) was received or
-     * request to peer timed out.
+     * Called either when @see doesntHave(Peer::pointer) was received from
+     * all asked peers or requests to peers timed out.
      */
     void tryNextPeer();
 
@@ -324,7 +324,7 @@ ManageOfferOpFrame::doApply(Application& app, LedgerDelta& delta,
                     throw std::runtime_error("offer claimed over limit");
                 }
 
-                mSourceAccount->storeChange(delta, db);
+                mSourceAccount->storeChange(tempDelta, db);
             }
             else
             {
@@ -334,7 +334,7 @@ ManageOfferOpFrame::doApply(Application& app, LedgerDelta& delta,
                     throw std::runtime_error("offer claimed over limit");
                 }
 
-                mWheatLineA->storeChange(delta, db);
+                mWheatLineA->storeChange(tempDelta, db);
             }
 
             if (sheep.type() == ASSET_TYPE_NATIVE)
@@ -344,7 +344,7 @@ ManageOfferOpFrame::doApply(Application& app, LedgerDelta& delta,
                     // this would indicate a bug in OfferExchange
                     throw std::runtime_error("offer sold more than balance");
                 }
-                mSourceAccount->storeChange(delta, db);
+                mSourceAccount->storeChange(tempDelta, db);
             }
             else
             {
@@ -353,7 +353,7 @@ ManageOfferOpFrame::doApply(Application& app, LedgerDelta& delta,
                     // this would indicate a bug in OfferExchange
                     throw std::runtime_error("offer sold more than balance");
                 }
-                mSheepLineA->storeChange(delta, db);
+                mSheepLineA->storeChange(tempDelta, db);
             }
         }
 
@@ -531,33 +531,30 @@ exchangeV10(Price price, int64_t maxWheatSend, int64_t maxWheatReceive,
 
 LoadBestOfferContext::LoadBestOfferContext(Database& db, Asset const& selling,
                                            Asset const& buying)
-    : mSelling(selling), mBuying(buying), mDb(db), mBatchIterator(mBatch.end())
+    : mSelling(selling), mBuying(buying), mDb(db), mStarted(false)
 {
-    loadBatchIfNecessary();
-}
-
-void
-LoadBestOfferContext::loadBatchIfNecessary()
-{
-    if (mBatchIterator == mBatch.end())
-    {
-        mBatch.clear();
-        OfferFrame::loadBestOffers(5, 0, mSelling, mBuying, mBatch, mDb);
-        mBatchIterator = mBatch.begin();
-    }
 }
 
 OfferFrame::pointer
 LoadBestOfferContext::loadBestOffer()
 {
-    return (mBatchIterator != mBatch.end()) ? *mBatchIterator : nullptr;
+    auto const& offers = mDb.getOrderBook().getOffers(mSelling, mBuying, mDb);
+    auto it = mStarted ? offers.upper_bound(mLast) : offers.begin();
+    if (it == offers.end())
+    {
+        return nullptr;
+    }
+    mCurrent = it->first;
+    return std::make_shared<OfferFrame>(it->second);
 }
 
 void
 LoadBestOfferContext::eraseAndUpdate()
 {
-    ++mBatchIterator;
-    loadBatchIfNecessary();
+    // the offer was usually deleted from the book already, skip it in case
+    // it was not
+    mLast = mCurrent;
+    mStarted = true;
 }
 
 OfferExchange::OfferExchange(LedgerDelta& delta, LedgerManager& ledgerManager)
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
 #include "ledger/TrustFrame.h"
 #include "transactions/OperationFrame.h"
 #include <functional>
@@ -72,6 +73,8 @@ int64_t adjustOffer(Price const& price, int64_t maxWheatSend,
 bool checkPriceErrorBound(Price price, int64_t wheatReceive, int64_t sheepSend,
                           bool canFavorWheat);
 
+// walks the offers of an asset pair from best to worst, using the in-memory
+// order book maintained by the database
 class LoadBestOfferContext
 {
     Asset const mSelling;
@@ -79,10 +82,10 @@ class LoadBestOfferContext
 
     Database& mDb;
 
-    std::vector<OfferFrame::pointer> mBatch;
-    std::vector<OfferFrame::pointer>::iterator mBatchIterator;
-
-    void loadBatchIfNecessary();
+    // offers up to mLast (included) were erased by the caller
+    bool mStarted;
+    OrderBook::OfferKey mLast;
+    OrderBook::OfferKey mCurrent;
 
   public:
     LoadBestOfferContext(Database& db, Asset const& selling,
@@ -9,9 +9,10 @@
 #include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
 #include "transactions/SignatureUtils.h"
-#include "util/Algoritm.h"
 #include "util/XDROperators.h"
 
+#include <algorithm>
+
 namespace stellar
 {
 
@@ -25,6 +26,48 @@ SignatureChecker::SignatureChecker(
     mUsedSignatures.resize(mSignatures.size());
 }
 
+uint64_t
+SignatureChecker::signerIndexKey(SignerKeyType type, SignatureHint const& hint)
+{
+    uint64_t res = static_cast<uint32_t>(type);
+    for (auto b : hint)
+    {
+        res = (res << 8) | b;
+    }
+    return res;
+}
+
+void
+SignatureChecker::indexSigners(std::vector<Signer> const& signers)
+{
+    mSignerIndex.clear();
+    for (size_t i = 0; i < signers.size(); i++)
+    {
+        auto const& key = signers[i].key;
+        switch (key.type())
+        {
+        case SIGNER_KEY_TYPE_ED25519:
+            mSignerIndex.emplace_back(
+                signerIndexKey(key.type(),
+                               SignatureUtils::getHint(key.ed25519())),
+                i);
+            break;
+        case SIGNER_KEY_TYPE_HASH_X:
+            mSignerIndex.emplace_back(
+                signerIndexKey(key.type(),
+                               SignatureUtils::getHint(key.hashX())),
+                i);
+            break;
+        default:
+            break;
+        }
+    }
+    // signers sharing a hint stay in the order of the signer list
+    std::sort(mSignerIndex.begin(), mSignerIndex.end());
+
+    mUsedSigners.assign(signers.size(), false);
+}
+
 bool
 SignatureChecker::checkSignature(AccountID const& accountID,
                                  std::vector<Signer> const& signersV,
@@ -35,9 +78,6 @@ SignatureChecker::checkSignature(AccountID const& accountID,
         return true;
     }
 
-    auto signers =
-        split(signersV, [](const Signer& s) { return s.key.type(); });
-
     // calculate the weight of the signatures
     int totalWeight = 0;
 
@@ -46,9 +86,10 @@ SignatureChecker::checkSignature(AccountID const& accountID,
     // current transaction hash is not stored in getEnvelope().signatures - it
     // is
     // computed with getContentsHash() method
-    for (auto const& signerKey : signers[SIGNER_KEY_TYPE_PRE_AUTH_TX])
+    for (auto const& signerKey : signersV)
     {
-        if (signerKey.key.preAuthTx() == mContentsHash)
+        if (signerKey.key.type() == SIGNER_KEY_TYPE_PRE_AUTH_TX &&
+            signerKey.key.preAuthTx() == mContentsHash)
         {
             mUsedOneTimeSignerKeys[accountID].insert(signerKey.key);
             totalWeight += signerKey.weight;
@@ -57,50 +98,45 @@ SignatureChecker::checkSignature(AccountID const& accountID,
         }
     }
 
-    using VerifyT =
-        std::function<bool(DecoratedSignature const&, Signer const&)>;
-    auto verifyAll = [&](std::vector<Signer>& signers, VerifyT verify) {
+    indexSigners(signersV);
+
+    // every signature is matched against the first unused signer of the
+    // given type having the same hint, hash(x) signers are tried first
+    for (auto type : {SIGNER_KEY_TYPE_HASH_X, SIGNER_KEY_TYPE_ED25519})
+    {
         for (size_t i = 0; i < mSignatures.size(); i++)
         {
             auto const& sig = mSignatures[i];
+            auto key = signerIndexKey(type, sig.hint);
 
-            for (auto it = signers.begin(); it != signers.end(); ++it)
+            for (auto it = std::lower_bound(mSignerIndex.begin(),
+                                            mSignerIndex.end(),
+                                            std::make_pair(key, size_t(0)));
+                 it != mSignerIndex.end() && it->first == key; ++it)
             {
-                auto& signerKey = *it;
-                if (verify(sig, signerKey))
+                if (mUsedSigners[it->second])
+                {
+                    continue;
+                }
+
+                auto const& signerKey = signersV[it->second];
+                auto verified =
+                    type == SIGNER_KEY_TYPE_HASH_X
+                        ? SignatureUtils::verifyHashX(sig, signerKey.key)
+                        : SignatureUtils::verify(sig, signerKey.key,
+                                                 mContentsHash);
+                if (verified)
                 {
                     mUsedSignatures[i] = true;
                     totalWeight += signerKey.weight;
                     if (totalWeight >= neededWeight)
                         return true;
 
-                    signers.erase(it);
+                    mUsedSigners[it->second] = true;
                     break;
                 }
             }
         }
-
-        return false;
-    };
-
-    auto verified =
-        verifyAll(signers[SIGNER_KEY_TYPE_HASH_X],
-                  [&](DecoratedSignature const& sig, Signer const& signerKey) {
-                      return SignatureUtils::verifyHashX(sig, signerKey.key);
-                  });
-    if (verified)
-    {
-        return true;
-    }
-
-    verified = verifyAll(
-        signers[SIGNER_KEY_TYPE_ED25519],
-        [&](DecoratedSignature const& sig, Signer const& signerKey) {
-            return SignatureUtils::verify(sig, signerKey.key, mContentsHash);
-        });
-    if (verified)
-    {
-        return true;
     }
 
     return false;
@@ -39,5 +39,15 @@ class SignatureChecker
 
     std::vector<bool> mUsedSignatures;
     UsedOneTimeSignerKeys mUsedOneTimeSignerKeys;
+
+    // signers of the account being checked, as (type and hint, position in
+    // the signer list) sorted so that the signers a signature may match can
+    // be found with a binary search; kept across calls to reuse the memory
+    std::vector<std::pair<uint64_t, size_t>> mSignerIndex;
+    std::vector<bool> mUsedSigners;
+
+    static uint64_t signerIndexKey(SignerKeyType type,
+                                   SignatureHint const& hint);
+    void indexSigners(std::vector<Signer> const& signers);
 };
 };
@@ -0,0 +1,109 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/KeyUtils.h"
+#include "crypto/Random.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
+#include "lib/catch.hpp"
+#include "transactions/SignatureChecker.h"
+#include "transactions/SignatureUtils.h"
+#include "util/XDROperators.h"
+
+using namespace stellar;
+
+namespace
+{
+SignerKey
+ed25519Signer(SecretKey const& key)
+{
+    return KeyUtils::convertKey<SignerKey>(key.getPublicKey());
+}
+
+// a signer of the same type as `key`, sharing its hint, that no signature
+// can match
+SignerKey
+decoySigner(SignerKey const& key)
+{
+    SignerKey res = key;
+    auto& bytes =
+        key.type() == SIGNER_KEY_TYPE_HASH_X ? res.hashX() : res.ed25519();
+    auto hint = SignatureUtils::getHint(bytes);
+    bytes = HashUtils::random();
+    std::copy(hint.begin(), hint.end(), bytes.end() - hint.size());
+    return res;
+}
+}
+
+TEST_CASE("signature checker", "[tx][signature]")
+{
+    auto contentsHash = HashUtils::random();
+    xdr::xvector<DecoratedSignature, 20> signatures;
+    std::vector<Signer> signers;
+
+    std::vector<SecretKey> keys;
+    for (int i = 0; i < 12; i++)
+    {
+        keys.emplace_back(SecretKey::random());
+        signers.emplace_back(ed25519Signer(keys.back()), 1);
+    }
+
+    SECTION("weights of matching signatures add up")
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            signatures.push_back(SignatureUtils::sign(keys[i], contentsHash));
+        }
+
+        SignatureChecker checker{10, contentsHash, signatures};
+        REQUIRE(checker.checkSignature(keys[0].getPublicKey(), signers, 5));
+        REQUIRE(checker.checkAllSignaturesUsed());
+
+        SignatureChecker checker2{10, contentsHash, signatures};
+        REQUIRE(!checker2.checkSignature(keys[0].getPublicKey(), signers, 6));
+    }
+
+    SECTION("a signer is only counted once")
+    {
+        signatures.push_back(SignatureUtils::sign(keys[3], contentsHash));
+        signatures.push_back(SignatureUtils::sign(keys[3], contentsHash));
+
+        SignatureChecker checker{10, contentsHash, signatures};
+        REQUIRE(!checker.checkSignature(keys[0].getPublicKey(), signers, 2));
+        REQUIRE(!checker.checkAllSignaturesUsed());
+    }
+
+    SECTION("signers sharing a hint")
+    {
+        auto x = randomBytes(32);
+        SignerKey hashX;
+        hashX.type(SIGNER_KEY_TYPE_HASH_X);
+        hashX.hashX() = sha256(x);
+
+        // decoys come first in the list and do not verify
+        signers.emplace(signers.begin(), hashX, 1);
+        signers.emplace(signers.begin(), decoySigner(hashX), 1);
+        signers.emplace(signers.begin(), decoySigner(signers.back().key), 1);
+
+        signatures.push_back(SignatureUtils::signHashX(x));
+        signatures.push_back(SignatureUtils::sign(keys[11], contentsHash));
+
+        SignatureChecker checker{10, contentsHash, signatures};
+        REQUIRE(checker.checkSignature(keys[0].getPublicKey(), signers, 2));
+        REQUIRE(checker.checkAllSignaturesUsed());
+    }
+
+    SECTION("pre-authorized transaction")
+    {
+        SignerKey preAuth;
+        preAuth.type(SIGNER_KEY_TYPE_PRE_AUTH_TX);
+        preAuth.preAuthTx() = contentsHash;
+        signers.emplace_back(preAuth, 2);
+
+        SignatureChecker checker{10, contentsHash, signatures};
+        REQUIRE(checker.checkSignature(keys[0].getPublicKey(), signers, 2));
+        REQUIRE(checker.usedOneTimeSignerKeys().size() == 1);
+    }
+}
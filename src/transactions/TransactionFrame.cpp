@@ -6,7 +6,9 @@
 #include "TransactionFrame.h"
 #include "OperationFrame.h"
 #include "crypto/Hex.h"
+#include "crypto/ParallelSigVerifier.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
 #include "database/Database.h"
 #include "database/DatabaseUtils.h"
@@ -29,6 +31,7 @@
 
 #include <algorithm>
 #include <numeric>
+#include <thread>
 
 namespace stellar
 {
@@ -49,12 +52,23 @@ TransactionFrame::TransactionFrame(Hash const& networkID,
 {
 }
 
+xdr::opaque_vec<> const&
+TransactionFrame::getEnvelopeBytes() const
+{
+    // an encoded envelope is never empty
+    if (mEnvelopeBytes.empty())
+    {
+        mEnvelopeBytes = xdr::xdr_to_opaque(mEnvelope);
+    }
+    return mEnvelopeBytes;
+}
+
 Hash const&
 TransactionFrame::getFullHash() const
 {
     if (isZero(mFullHash))
     {
-        mFullHash = sha256(xdr::xdr_to_opaque(mEnvelope));
+        mFullHash = sha256(getEnvelopeBytes());
     }
     return (mFullHash);
 }
@@ -64,8 +78,21 @@ TransactionFrame::getContentsHash() const
 {
     if (isZero(mContentsHash))
     {
-        mContentsHash = sha256(
-            xdr::xdr_to_opaque(mNetworkID, ENVELOPE_TYPE_TX, mEnvelope.tx));
+        if (mEnvelopeBytes.empty())
+        {
+            mContentsHash = sha256(xdr::xdr_to_opaque(
+                mNetworkID, ENVELOPE_TYPE_TX, mEnvelope.tx));
+        }
+        else
+        {
+            // the transaction is the beginning of the envelope
+            auto hasher = SHA256::create();
+            hasher->add(mNetworkID);
+            hasher->add(xdr::xdr_to_opaque(ENVELOPE_TYPE_TX));
+            hasher->add(ByteSlice(mEnvelopeBytes.data(),
+                                  xdr::xdr_size(mEnvelope.tx)));
+            mContentsHash = hasher->finish();
+        }
     }
     return (mContentsHash);
 }
@@ -76,6 +103,7 @@ TransactionFrame::clearCached()
     Hash zero;
     mContentsHash = zero;
     mFullHash = zero;
+    mEnvelopeBytes.clear();
 }
 
 TransactionResultPair
@@ -136,6 +164,8 @@ void
 TransactionFrame::addSignature(DecoratedSignature const& signature)
 {
     mEnvelope.signatures.push_back(signature);
+    mFullHash = Hash();
+    mEnvelopeBytes.clear();
 }
 
 bool
@@ -170,6 +200,19 @@ TransactionFrame::loadAccount(int ledgerProtocolVersion, LedgerDelta* delta,
     {
         res = AccountFrame::loadAccount(*delta, accountID, db);
     }
+    else if (mAccountSnapshot)
+    {
+        auto it = mAccountSnapshot->find(accountID);
+        if (it == mAccountSnapshot->end())
+        {
+            throw std::runtime_error("account not in snapshot");
+        }
+        if (it->second)
+        {
+            // the snapshot is shared with other transactions
+            res = std::make_shared<AccountFrame>(*it->second);
+        }
+    }
     else
     {
         res = AccountFrame::loadAccount(accountID, db);
@@ -177,6 +220,90 @@ TransactionFrame::loadAccount(int ledgerProtocolVersion, LedgerDelta* delta,
     return res;
 }
 
+TransactionFrame::AccountSnapshot
+TransactionFrame::prefetchAccounts(std::vector<TransactionFramePtr> const& txs,
+                                   Database& db)
+{
+    std::vector<AccountID> accountIDs;
+    accountIDs.reserve(txs.size());
+    for (auto const& tx : txs)
+    {
+        accountIDs.emplace_back(tx->getSourceID());
+        for (auto const& op : tx->getEnvelope().tx.operations)
+        {
+            if (op.sourceAccount)
+            {
+                accountIDs.emplace_back(*op.sourceAccount);
+            }
+        }
+    }
+    return AccountFrame::loadAccounts(accountIDs, db);
+}
+
+void
+TransactionFrame::preVerifySignatures(
+    std::vector<TransactionFramePtr> const& txs, Application& app)
+{
+    ParallelSigVerifier verifier;
+
+    auto& db = app.getDatabase();
+    for (auto const& tx : txs)
+    {
+        auto const& env = tx->getEnvelope();
+        if (env.signatures.empty())
+        {
+            continue;
+        }
+
+        std::set<AccountID> sources;
+        sources.insert(tx->getSourceID());
+        for (auto const& op : env.tx.operations)
+        {
+            if (op.sourceAccount)
+            {
+                sources.insert(*op.sourceAccount);
+            }
+        }
+
+        // ed25519 keys that may have signed this transaction
+        std::set<PublicKey> candidates;
+        for (auto const& id : sources)
+        {
+            candidates.insert(id);
+            auto account = AccountFrame::loadAccount(id, db);
+            if (!account)
+            {
+                continue;
+            }
+            for (auto const& signer : account->getAccount().signers)
+            {
+                if (signer.key.type() == SIGNER_KEY_TYPE_ED25519)
+                {
+                    candidates.insert(
+                        KeyUtils::convertKey<PublicKey>(signer.key));
+                }
+            }
+        }
+
+        auto const& contentsHash = tx->getContentsHash();
+        for (auto const& sig : env.signatures)
+        {
+            for (auto const& key : candidates)
+            {
+                if (SignatureUtils::doesHintMatch(key.ed25519(), sig.hint))
+                {
+                    verifier.add(key, sig.signature, contentsHash);
+                }
+            }
+        }
+    }
+
+    // results end up in the signature verification cache, where
+    // SignatureChecker finds them
+    verifier.verify(app.getWorkerIOService(),
+                    std::thread::hardware_concurrency());
+}
+
 bool
 TransactionFrame::loadAccount(int ledgerProtocolVersion, LedgerDelta* delta,
                               Database& db)
@@ -539,6 +666,24 @@ TransactionFrame::checkValid(Application& app, SequenceNumber current)
     return res;
 }
 
+bool
+TransactionFrame::checkValid(Application& app, SequenceNumber current,
+                             AccountSnapshot const& accounts)
+{
+    mAccountSnapshot = &accounts;
+    try
+    {
+        bool res = checkValid(app, current);
+        mAccountSnapshot = nullptr;
+        return res;
+    }
+    catch (...)
+    {
+        mAccountSnapshot = nullptr;
+        throw;
+    }
+}
+
 void
 TransactionFrame::markResultFailed()
 {
@@ -679,7 +824,7 @@ TransactionFrame::storeTransaction(LedgerManager& ledgerManager,
                                    TransactionMeta& tm, int txindex,
                                    TransactionResultSet& resultSet) const
 {
-    auto txBytes(xdr::xdr_to_opaque(mEnvelope));
+    auto const& txBytes = getEnvelopeBytes();
 
     resultSet.results.emplace_back(getResultPair());
     auto txResultBytes(xdr::xdr_to_opaque(resultSet.results.back()));
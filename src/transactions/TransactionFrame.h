@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 namespace soci
 {
@@ -35,16 +36,24 @@ using TransactionFramePtr = std::shared_ptr<TransactionFrame>;
 
 class TransactionFrame
 {
+  public:
+    // accounts loaded ahead of time; missing accounts map to nullptr
+    typedef std::unordered_map<AccountID, AccountFrame::pointer>
+        AccountSnapshot;
+
   protected:
     TransactionEnvelope mEnvelope;
     TransactionResult mResult;
 
     AccountFrame::pointer mSigningAccount;
+    // when set, accounts are read from there instead of the database
+    AccountSnapshot const* mAccountSnapshot{nullptr};
 
     void clearCached();
     Hash const& mNetworkID;     // used to change the way we compute signatures
     mutable Hash mContentsHash; // the hash of the contents
     mutable Hash mFullHash;     // the hash of the contents and the sig.
+    mutable xdr::opaque_vec<> mEnvelopeBytes; // XDR of mEnvelope
 
     std::vector<std::shared_ptr<OperationFrame>> mOperations;
 
@@ -99,6 +108,9 @@ class TransactionFrame
 
     Hash const& getFullHash() const;
     Hash const& getContentsHash() const;
+    // XDR encoding of the envelope, computed once and shared by hashing,
+    // tx set hashing and persistence
+    xdr::opaque_vec<> const& getEnvelopeBytes() const;
 
     std::vector<std::shared_ptr<OperationFrame>> const&
     getOperations() const
@@ -161,6 +173,12 @@ class TransactionFrame
 
     bool checkValid(Application& app, SequenceNumber current);
 
+    // same as above but reads accounts from `accounts`, which must hold the
+    // source accounts of the transaction and of its operations; as it does
+    // not touch the database, it can run on a worker thread
+    bool checkValid(Application& app, SequenceNumber current,
+                    AccountSnapshot const& accounts);
+
     // collect fee, consume sequence number
     void processFeeSeqNum(LedgerDelta& delta, LedgerManager& ledgerManager);
 
@@ -177,6 +195,20 @@ class TransactionFrame
                                       LedgerDelta* delta, Database& app,
                                       AccountID const& accountID);
 
+    // loads the source accounts of the transactions and of their operations
+    // in batches, so that later calls to loadAccount hit the entry cache
+    static AccountSnapshot
+    prefetchAccounts(std::vector<TransactionFramePtr> const& txs,
+                     Database& db);
+
+    // verifies, on the worker threads, the signatures of the transactions
+    // against the keys of their source accounts so that signature checks
+    // done later on the main thread hit the verification cache; accounts
+    // should be prefetched first
+    static void
+    preVerifySignatures(std::vector<TransactionFramePtr> const& txs,
+                        Application& app);
+
     // transaction history
     void storeTransaction(LedgerManager& ledgerManager, TransactionMeta& tm,
                           int txindex, TransactionResultSet& resultSet) const;
@@ -4,6 +4,7 @@
 
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
+#include "crypto/SHA.h"
 #include "crypto/SignerKey.h"
 #include "crypto/SignerKeyUtils.h"
 #include "ledger/LedgerManager.h"
@@ -23,6 +24,7 @@
 #include "transactions/SignatureUtils.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
+#include "xdrpp/marshal.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
@@ -36,6 +38,32 @@ typedef std::unique_ptr<Application> appPtr;
     double spend
 */
 
+TEST_CASE("txenvelope hashes", "[tx][envelope]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = getAccount("A");
+    auto tx = root.tx({createAccount(a1.getPublicKey(), 1000000000),
+                       payment(a1.getPublicKey(), 100)});
+
+    auto check = [&]() {
+        auto const& env = tx->getEnvelope();
+        REQUIRE(tx->getEnvelopeBytes() == xdr::xdr_to_opaque(env));
+        REQUIRE(tx->getFullHash() == sha256(xdr::xdr_to_opaque(env)));
+        REQUIRE(tx->getContentsHash() ==
+                sha256(xdr::xdr_to_opaque(app->getNetworkID(),
+                                          ENVELOPE_TYPE_TX, env.tx)));
+    };
+
+    check();
+    // adding a signature drops the cached encoding
+    tx->addSignature(a1);
+    check();
+}
+
 TEST_CASE("txenvelope", "[tx][envelope]")
 {
     Config const& cfg = getTestConfig();
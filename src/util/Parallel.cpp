@@ -0,0 +1,90 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace stellar
+{
+
+namespace
+{
+struct ParallelForState
+{
+    std::function<void(size_t)> const* mFunction;
+    size_t mSize;
+    std::atomic<size_t> mNext{0};
+
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    size_t mCompleted{0};
+    std::exception_ptr mError;
+
+    void
+    run()
+    {
+        size_t i;
+        // mFunction is only used while some call is pending, which keeps
+        // parallelFor (and the function it was given) alive
+        while ((i = mNext++) < mSize)
+        {
+            std::exception_ptr error;
+            try
+            {
+                (*mFunction)(i);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> guard(mMutex);
+            if (error && !mError)
+            {
+                mError = error;
+            }
+            if (++mCompleted == mSize)
+            {
+                mDone.notify_all();
+            }
+        }
+    }
+};
+}
+
+void
+parallelFor(asio::io_service& workers, size_t numThreads, size_t n,
+            std::function<void(size_t)> const& f)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->mFunction = &f;
+    state->mSize = n;
+
+    auto helpers = std::min(numThreads, n - 1);
+    for (size_t i = 0; i < helpers; i++)
+    {
+        workers.post([state]() { state->run(); });
+    }
+
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mMutex);
+    state->mDone.wait(lock, [&state]() { return state->mCompleted == n; });
+    if (state->mError)
+    {
+        std::rethrow_exception(state->mError);
+    }
+}
+}
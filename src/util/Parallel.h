@@ -0,0 +1,21 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include <functional>
+
+namespace stellar
+{
+
+// Calls f(0) ... f(n - 1) from up to `numThreads` tasks posted on `workers`
+// and from the calling thread, and returns once all calls completed. The
+// calling thread keeps picking up work itself, so it never waits on tasks
+// that did not get scheduled yet (the worker threads may be busy with long
+// running jobs such as bucket merges).
+// The first exception thrown by f is rethrown on the calling thread.
+void parallelFor(asio::io_service& workers, size_t numThreads, size_t n,
+                 std::function<void(size_t)> const& f);
+}
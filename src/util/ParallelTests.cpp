@@ -0,0 +1,63 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "util/Parallel.h"
+
+#include "lib/catch.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace stellar;
+
+TEST_CASE("parallelFor", "[parallel]")
+{
+    asio::io_service workers;
+    asio::io_service::work work(workers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; i++)
+    {
+        threads.emplace_back([&workers]() { workers.run(); });
+    }
+
+    SECTION("calls each index once")
+    {
+        std::vector<std::atomic<int>> calls(1000);
+        parallelFor(workers, threads.size(), calls.size(),
+                    [&calls](size_t i) { ++calls[i]; });
+        for (auto const& c : calls)
+        {
+            REQUIRE(c == 1);
+        }
+    }
+
+    SECTION("nothing to do")
+    {
+        parallelFor(workers, threads.size(), 0,
+                    [](size_t) { throw std::runtime_error("unexpected"); });
+    }
+
+    SECTION("rethrows on the calling thread")
+    {
+        std::atomic<int> calls(0);
+        REQUIRE_THROWS_AS(parallelFor(workers, threads.size(), 100,
+                                      [&calls](size_t i) {
+                                          ++calls;
+                                          if (i == 42)
+                                          {
+                                              throw std::runtime_error("42");
+                                          }
+                                      }),
+                          std::runtime_error);
+        REQUIRE(calls == 100);
+    }
+
+    workers.stop();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
@@ -90,7 +90,21 @@ enum MessageType
     GET_SCP_STATE = 12,
 
     // new messages
-    HELLO = 13
+    HELLO = 13,
+
+    // pull mode transaction flooding, overlay version 8 and above
+    FLOOD_ADVERT = 14,
+    FLOOD_DEMAND = 15,
+
+    // batched transactions, overlay version 9 and above
+    TRANSACTIONS = 16,
+
+    // compact tx sets, overlay version 10 and above
+    GET_COMPACT_TX_SET = 17,
+    COMPACT_TX_SET = 18,
+
+    // flow control, overlay version 11 and above
+    SEND_MORE = 19
 };
 
 struct DontHave
@@ -99,6 +113,58 @@ struct DontHave
     uint256 reqHash;
 };
 
+const TX_ADVERT_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxAdvertVector<TX_ADVERT_VECTOR_MAX_SIZE>;
+
+// hashes of transaction envelopes the sender can provide
+struct FloodAdvert
+{
+    TxAdvertVector txHashes;
+};
+
+const TX_DEMAND_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxDemandVector<TX_DEMAND_VECTOR_MAX_SIZE>;
+
+// hashes of advertised transaction envelopes the sender wants to receive
+struct FloodDemand
+{
+    TxDemandVector txHashes;
+};
+
+const TX_BATCH_MAX_SIZE = 100;
+typedef TransactionEnvelope TransactionBatch<TX_BATCH_MAX_SIZE>;
+
+// SipHash-2-4 of the full hash of a transaction envelope, keyed by the first
+// 16 bytes of the hash of the tx set it is in, read as little endian
+typedef uint64 ShortTxID;
+
+// request for a tx set in compact form; `missingTxs` lists the transactions
+// the sender could not find after receiving the compact form once
+struct GetCompactTxSet
+{
+    uint256 txSetHash;
+    ShortTxID missingTxs<>;
+};
+
+// a tx set, as the short ids of its transactions in hash order, plus the
+// envelopes of the transactions listed in the request
+struct CompactTxSet
+{
+    uint256 txSetHash;
+    Hash previousLedgerHash;
+    ShortTxID txs<>;
+    TransactionEnvelope missingTxs<>;
+};
+
+// credits granted to the receiver for sending more messages: SCP messages
+// take from numSCPMessages, the others from numMessages and numBytes
+struct SendMore
+{
+    uint32 numMessages;
+    uint32 numBytes;
+    uint32 numSCPMessages;
+};
+
 union StellarMessage switch (MessageType type)
 {
 case ERROR_MSG:
@@ -131,6 +197,19 @@ case SCP_MESSAGE:
     SCPEnvelope envelope;
 case GET_SCP_STATE:
     uint32 getSCPLedgerSeq; // ledger seq requested ; if 0, requests the latest
+
+case FLOOD_ADVERT:
+    FloodAdvert floodAdvert;
+case FLOOD_DEMAND:
+    FloodDemand floodDemand;
+case TRANSACTIONS:
+    TransactionBatch transactions;
+case GET_COMPACT_TX_SET:
+    GetCompactTxSet getCompactTxSet;
+case COMPACT_TX_SET:
+    CompactTxSet compactTxSet;
+case SEND_MORE:
+    SendMore sendMore;
 };
 
 union AuthenticatedMessage switch (uint32 v)